@@ -0,0 +1,94 @@
+#include <stdlib.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <nvif/client.h>
+#include <nvif/device.h>
+#include <nvif/class.h>
+
+#include <core/memory.h>
+
+#include "util.h"
+
+static double
+mibps(u64 size, int loops, s64 time)
+{
+	return ((double)size * loops / (1024 * 1024)) / ((double)time / 1e9);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct nvif_client client;
+	struct nvif_device device;
+	struct nvkm_memory *memory;
+	u64 size = 4 * 1024 * 1024;
+	int loops = 16, ret, c, i;
+	void __iomem *map;
+	s64 wr, rd;
+	void *buf;
+
+	while ((c = getopt(argc, argv, "l:s:u"U_GETOPT)) != -1) {
+		switch (c) {
+		case 'l': loops = strtol(optarg, NULL, 0); break;
+		case 's': size = strtoull(optarg, NULL, 0); break;
+		case 'u': os_device_wc = false; break;
+		default:
+			if (!u_option(c))
+				return 1;
+			break;
+		}
+	}
+
+	if (!(buf = malloc(size)))
+		return 1;
+	memset(buf, 0x5a, size);
+
+	ret = u_device("lib", argv[0], "error", true, true, ~0ULL,
+		       0x00000000, &client, &device);
+	if (ret)
+		goto done;
+
+	ret = nvkm_memory_new(nvxx_device(&device), NVKM_MEM_TARGET_INST,
+			      size, 0x1000, false, &memory);
+	if (ret) {
+		printf("failed to allocate %lld bytes, %d\n", size, ret);
+		goto fini;
+	}
+
+	/* instance memory is reached through the BAR aperture, where the
+	 * chipset allows, which is the path being measured here
+	 */
+	if (!(map = nvkm_kmap(memory))) {
+		printf("no cpu mapping of instance memory\n");
+		nvkm_done(memory);
+		ret = -ENODEV;
+		goto free;
+	}
+
+	wr = ktime_to_ns(ktime_get());
+	for (i = 0; i < loops; i++)
+		memcpy_toio(map, buf, size);
+	ioread32_native(map);
+	wr = ktime_to_ns(ktime_get()) - wr;
+
+	rd = ktime_to_ns(ktime_get());
+	for (i = 0; i < loops; i++)
+		memcpy_fromio(buf, map, size);
+	rd = ktime_to_ns(ktime_get()) - rd;
+	nvkm_done(memory);
+
+	printf("%s, %lld bytes x %d\n", os_device_wc ? "write-combined" :
+					 "uncached", size, loops);
+	printf("write: %10.2f MiB/s\n", mibps(size, loops, wr));
+	printf("read : %10.2f MiB/s\n", mibps(size, loops, rd));
+
+free:
+	nvkm_memory_del(&memory);
+fini:
+	nvif_device_fini(&device);
+	nvif_client_fini(&client);
+done:
+	free(buf);
+	return ret;
+}
@@ -0,0 +1,105 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <nvif/os.h>
+
+#include <core/event.h>
+#include <core/notify.h>
+
+/* a synthetic event, with subscribers spread round-robin over its types
+ * and indices the way per-head/per-channel users would be, so that each
+ * nvkm_event_send() only has subscribers/(types * indices) to notify
+ */
+struct u_req {
+	u32 types;
+	int index;
+};
+
+static u64 u_hits;
+
+static int
+u_ctor(struct nvkm_object *object, void *data, u32 size,
+       struct nvkm_notify *notify)
+{
+	struct u_req *req = data;
+	notify->size = 0;
+	notify->types = req->types;
+	notify->index = req->index;
+	return 0;
+}
+
+static const struct nvkm_event_func
+u_event = {
+	.ctor = u_ctor,
+};
+
+static int
+u_func(struct nvkm_notify *notify)
+{
+	u_hits++;
+	return NVKM_NOTIFY_KEEP;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct nvkm_event event = {};
+	struct nvkm_notify *notify;
+	int types = 4, index = 64, count = 4096, loops = 200000;
+	int ret, c, i, n;
+	s64 time;
+
+	while ((c = getopt(argc, argv, "i:l:n:t:")) != -1) {
+		switch (c) {
+		case 'i': index = strtol(optarg, NULL, 0); break;
+		case 'l': loops = strtol(optarg, NULL, 0); break;
+		case 'n': count = strtol(optarg, NULL, 0); break;
+		case 't': types = strtol(optarg, NULL, 0); break;
+		default:
+			return 1;
+		}
+	}
+
+	if (types < 1 || types > 32 || index < 1 || count < 0 || loops < 1)
+		return 1;
+
+	if (!(notify = calloc(count, sizeof(*notify))))
+		return 1;
+
+	ret = nvkm_event_init(&u_event, types, index, &event);
+	if (ret)
+		goto done;
+
+	for (n = 0; n < count; n++) {
+		struct u_req req = {
+			.types = BIT(n % types),
+			.index = (n / types) % index,
+		};
+
+		ret = nvkm_notify_init(NULL, &event, u_func, false,
+				       &req, sizeof(req), 0, &notify[n]);
+		if (ret) {
+			printf("failed to add subscriber %d, %d\n", n, ret);
+			goto fini;
+		}
+
+		nvkm_notify_get(&notify[n]);
+	}
+
+	time = ktime_to_ns(ktime_get());
+	for (i = 0; i < loops; i++)
+		nvkm_event_send(&event, BIT(0), i % index, NULL, 0);
+	time = ktime_to_ns(ktime_get()) - time;
+
+	printf("%d subscribers, %d types x %d indices\n", count, types, index);
+	printf("send: %10.2f ns/op, %10.2f notified/op\n",
+	       (double)time / loops, (double)u_hits / loops);
+
+fini:
+	while (n--)
+		nvkm_notify_fini(&notify[n]);
+	nvkm_event_fini(&event);
+done:
+	free(notify);
+	return ret;
+}
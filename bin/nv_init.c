@@ -6,22 +6,62 @@
 #include <nvif/driver.h>
 #include <nvif/device.h>
 #include <nvif/class.h>
+#include <nvif/cl0080.h>
 
 #include "util.h"
 
+static void
+u_subdev_stats(struct nvif_device *device)
+{
+	static const char *name[] = { "preinit", "oneinit", "init", "fini" };
+	struct nv_device_subdev_stats_v0 *args;
+	u32 size;
+	int i, j;
+
+	size = sizeof(*args) + 255 * sizeof(args->entry[0]);
+	if (!(args = malloc(size)))
+		return;
+	args->version = 0;
+	args->count = 255;
+
+	if (nvif_mthd(&device->object, NV_DEVICE_V0_SUBDEV_STATS, args, size)) {
+		free(args);
+		return;
+	}
+
+	printf("%-10s %-8s %10s %10s %10s %10s\n", "subdev", "stage",
+	       "time(us)", "wait(us)", "rd", "wr");
+	for (i = 0; i < args->count; i++) {
+		for (j = 0; j < ARRAY_SIZE(args->entry[i].stat); j++) {
+			typeof(args->entry[i].stat[j]) *stat =
+				&args->entry[i].stat[j];
+			if (!stat->time && !stat->rd && !stat->wr)
+				continue;
+			printf("%-10.16s %-8s %10lld %10lld %10lld %10lld\n",
+			       args->entry[i].name, name[j], stat->time,
+			       stat->wait / 1000, stat->rd, stat->wr);
+		}
+	}
+
+	free(args);
+}
+
 int
 main(int argc, char **argv)
 {
 	struct nvif_client client;
 	struct nvif_device device;
-	bool suspend = false, wait = false;
+	bool suspend = false, wait = false, stats = false;
 	int ret, c;
 
-	while ((c = getopt(argc, argv, "sw"U_GETOPT)) != -1) {
+	while ((c = getopt(argc, argv, "stw"U_GETOPT)) != -1) {
 		switch (c) {
 		case 's':
 			suspend = true;
 			break;
+		case 't':
+			stats = true;
+			break;
 		case 'w':
 			wait = true;
 			break;
@@ -37,9 +77,14 @@ main(int argc, char **argv)
 	if (ret)
 		return ret;
 
+	if (stats)
+		u_subdev_stats(&device);
+
 	if (suspend) {
 		nvif_client_suspend(&client);
 		nvif_client_resume(&client);
+		if (stats)
+			u_subdev_stats(&device);
 	}
 
 	while (wait && (c = getchar()) == EOF) {
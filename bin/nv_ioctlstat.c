@@ -0,0 +1,168 @@
+#include <stdlib.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <nvif/client.h>
+#include <nvif/driver.h>
+#include <nvif/class.h>
+#include <nvif/ioctl.h>
+#include <nvif/if0000.h>
+
+#include "util.h"
+
+static const char *
+u_ioctl_name(u8 type)
+{
+	switch (type) {
+	case NVIF_IOCTL_V0_NOP     : return "NOP";
+	case NVIF_IOCTL_V0_SCLASS  : return "SCLASS";
+	case NVIF_IOCTL_V0_NEW     : return "NEW";
+	case NVIF_IOCTL_V0_DEL     : return "DEL";
+	case NVIF_IOCTL_V0_MTHD    : return "MTHD";
+	case NVIF_IOCTL_V0_RD      : return "RD";
+	case NVIF_IOCTL_V0_WR      : return "WR";
+	case NVIF_IOCTL_V0_MAP     : return "MAP";
+	case NVIF_IOCTL_V0_UNMAP   : return "UNMAP";
+	case NVIF_IOCTL_V0_NTFY_NEW: return "NTFY_NEW";
+	case NVIF_IOCTL_V0_NTFY_DEL: return "NTFY_DEL";
+	case NVIF_IOCTL_V0_NTFY_GET: return "NTFY_GET";
+	case NVIF_IOCTL_V0_NTFY_PUT: return "NTFY_PUT";
+	case NVIF_IOCTL_V0_RDV     : return "RDV";
+	case NVIF_IOCTL_V0_WRV     : return "WRV";
+	default:
+		return "UNKNOWN";
+	}
+}
+
+static int
+u_entry_cmp(const void *a, const void *b)
+{
+	const struct nv_client_ioctl_stats_entry_v0 *ea = a, *eb = b;
+	if (ea->time != eb->time)
+		return ea->time < eb->time ? 1 : -1;
+	return 0;
+}
+
+/* histogram bucket n counts calls that took [2^(n-1), 2^n) ns, so the
+ * upper bound of the bucket containing the percentile is reported
+ */
+static u64
+u_entry_pct(struct nv_client_ioctl_stats_entry_v0 *entry, int pct)
+{
+	u64 want = (entry->count * pct + 99) / 100, seen = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(entry->hist); i++) {
+		if ((seen += entry->hist[i]) >= want)
+			break;
+	}
+
+	return 1ULL << min(i, (int)ARRAY_SIZE(entry->hist) - 1);
+}
+
+static void
+u_entry_show(struct nv_client_ioctl_stats_entry_v0 *entry)
+{
+	printf("%-8s ", u_ioctl_name(entry->type));
+	if (entry->flags & NV_CLIENT_IOCTL_STATS_V0_ENTRY_OTHER)
+		printf("%-8s %-4s ", "other", "");
+	else
+	if (entry->flags & NV_CLIENT_IOCTL_STATS_V0_ENTRY_MTHD)
+		printf("%08x %02x   ", entry->oclass, entry->method);
+	else
+		printf("%-8s %-4s ", "", "");
+	printf("%10llu %12llu %9llu %9llu %9llu\n", entry->count,
+	       entry->time / 1000, entry->time / entry->count,
+	       u_entry_pct(entry, 50), u_entry_pct(entry, 99));
+}
+
+static void
+u_entry_list(struct nv_client_ioctl_stats_entry_v0 *entry, int count,
+	     bool mthd, int top)
+{
+	const u8 mask = NV_CLIENT_IOCTL_STATS_V0_ENTRY_MTHD;
+	int i, nr = 0;
+
+	printf("%-8s %-8s %-4s %10s %12s %9s %9s %9s\n", "type", "oclass",
+	       "mthd", "count", "total(us)", "avg(ns)", "p50(ns)", "p99(ns)");
+
+	for (i = 0; i < count && nr < top; i++) {
+		if (!!(entry[i].flags & mask) == mthd) {
+			u_entry_show(&entry[i]);
+			nr++;
+		}
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	struct nvif_client client;
+	struct nv_client_ioctl_stats_v0 *args = NULL;
+	u8 flags = 0;
+	int top = 20, count = 0, ret, c;
+
+	while ((c = getopt(argc, argv, "ersn:"U_GETOPT)) != -1) {
+		switch (c) {
+		case 'e':
+			flags |= NV_CLIENT_IOCTL_STATS_V0_ENABLE;
+			break;
+		case 'r':
+			flags |= NV_CLIENT_IOCTL_STATS_V0_RESET;
+			break;
+		case 's':
+			flags |= NV_CLIENT_IOCTL_STATS_V0_DISABLE;
+			break;
+		case 'n':
+			top = strtol(optarg, NULL, 0);
+			break;
+		default:
+			if (!u_option(c))
+				return 1;
+			break;
+		}
+	}
+
+	ret = u_client(NULL, argv[0], "error", false, false, 0, &client);
+	if (ret)
+		return ret;
+
+	/* the number of entries is only known once we've asked, so keep
+	 * growing the buffer until everything fits
+	 */
+	for (;;) {
+		u32 size = sizeof(*args) + count * sizeof(args->entry[0]);
+		free(args);
+		if (!(args = malloc(size))) {
+			ret = -ENOMEM;
+			goto done;
+		}
+		args->version = 0;
+		args->flags = flags;
+		args->count = count;
+
+		ret = nvif_mthd(&client.object, NV_CLIENT_IOCTL_STATS,
+				args, size);
+		if (ret) {
+			printf("ioctl stats: %d\n", ret);
+			goto done;
+		}
+
+		if (args->count <= count)
+			break;
+		count = args->count;
+		flags = 0;
+	}
+
+	qsort(args->entry, args->count, sizeof(args->entry[0]), u_entry_cmp);
+
+	printf("collection %s\n\n", args->enabled ? "enabled" : "disabled");
+	u_entry_list(args->entry, args->count, false, INT_MAX);
+	printf("\n");
+	u_entry_list(args->entry, args->count, true, top);
+
+done:
+	free(args);
+	nvif_client_fini(&client);
+	return ret;
+}
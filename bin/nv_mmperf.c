@@ -0,0 +1,194 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <nvif/os.h>
+
+#include <core/mm.h>
+
+/* one line per operation, slots name the allocations so frees can refer
+ * back to them:
+ *
+ *   h <slot> <heap> <type> <size_max> <size_min> <align>	nvkm_mm_head()
+ *   t <slot> <heap> <type> <size_max> <size_min> <align>	nvkm_mm_tail()
+ *   f <slot>							nvkm_mm_free()
+ */
+struct u_op {
+	char op;
+	u32 slot;
+	u8  heap;
+	u8  type;
+	u32 size_max;
+	u32 size_min;
+	u32 align;
+};
+
+static u64 u_seed = 88172645463325252ULL;
+
+static u32
+u_rand(void)
+{
+	u_seed ^= u_seed << 13;
+	u_seed ^= u_seed >> 7;
+	u_seed ^= u_seed << 17;
+	return u_seed;
+}
+
+/* frees a random slot whenever it's in use, so the heap settles at around
+ * half full with allocations of mixed size, type and alignment scattered
+ * across it, which is as bad as it gets for the free lists
+ */
+static struct u_op *
+u_trace_gen(u32 slots, int count)
+{
+	struct u_op *trace;
+	bool *used;
+	int i;
+
+	if (!(trace = calloc(count, sizeof(*trace))) ||
+	    !(used = calloc(slots, sizeof(*used)))) {
+		free(trace);
+		return NULL;
+	}
+
+	for (i = 0; i < count; i++) {
+		struct u_op *op = &trace[i];
+		op->slot = u_rand() % slots;
+		if (used[op->slot]) {
+			op->op = 'f';
+		} else {
+			op->op = (u_rand() & 1) ? 'h' : 't';
+			op->heap = (u_rand() % 8) ? 0 : 1 + (u_rand() % 2);
+			op->type = 1 + (u_rand() % 3);
+			op->size_max = 1 + (u_rand() % 64);
+			op->size_min = (u_rand() & 3) ? op->size_max : 1;
+			op->align = 1 << (u_rand() % 5);
+		}
+		used[op->slot] = !used[op->slot];
+	}
+
+	free(used);
+	return trace;
+}
+
+static struct u_op *
+u_trace_read(const char *path, u32 *slots, int *count)
+{
+	struct u_op *trace = NULL, *op;
+	int nr = 0, size = 0, ret;
+	FILE *file;
+
+	if (!(file = fopen(path, "r")))
+		return NULL;
+
+	*slots = 0;
+	for (;;) {
+		if (nr == size) {
+			size = size ? size * 2 : 4096;
+			if (!(op = realloc(trace, size * sizeof(*trace))))
+				goto fail;
+			trace = op;
+		}
+
+		op = &trace[nr];
+		memset(op, 0x00, sizeof(*op));
+		ret = fscanf(file, " %c %u", &op->op, &op->slot);
+		if (ret == EOF)
+			break;
+		if (ret != 2)
+			goto fail;
+
+		if (op->op != 'f') {
+			if (fscanf(file, "%hhu %hhu %u %u %u", &op->heap,
+				   &op->type, &op->size_max, &op->size_min,
+				   &op->align) != 5)
+				goto fail;
+		}
+
+		*slots = max(*slots, op->slot + 1);
+		nr++;
+	}
+
+	fclose(file);
+	*count = nr;
+	return trace;
+fail:
+	printf("%s: bad trace entry %d\n", path, nr);
+	fclose(file);
+	free(trace);
+	return NULL;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct nvkm_mm mm = {};
+	struct nvkm_mm_node **node;
+	struct u_op *trace;
+	const char *path = NULL;
+	u32 slots = 65536, i;
+	int count = 1000000, fail = 0, ret, c, n;
+	s64 time;
+
+	while ((c = getopt(argc, argv, "f:n:s:")) != -1) {
+		switch (c) {
+		case 'f': path = optarg; break;
+		case 'n': count = strtol(optarg, NULL, 0); break;
+		case 's': slots = strtoul(optarg, NULL, 0); break;
+		default:
+			return 1;
+		}
+	}
+
+	if (path)
+		trace = u_trace_read(path, &slots, &count);
+	else
+		trace = u_trace_gen(slots, count);
+	if (!trace || !(node = calloc(slots, sizeof(*node)))) {
+		free(trace);
+		return 1;
+	}
+
+	/* two ranges with a hole between them, like vram either side of
+	 * a reserved region
+	 */
+	ret = nvkm_mm_init(&mm, 0, 0x100000, 4);
+	if (ret == 0)
+		ret = nvkm_mm_init(&mm, 0x100800, 0x1000000, 4);
+	if (ret)
+		goto done;
+
+	time = ktime_to_ns(ktime_get());
+	for (n = 0; n < count; n++) {
+		struct u_op *op = &trace[n];
+		switch (op->op) {
+		case 'h':
+		case 't':
+			if (node[op->slot])
+				nvkm_mm_free(&mm, &node[op->slot]);
+			ret = (op->op == 'h' ? nvkm_mm_head : nvkm_mm_tail)
+				(&mm, op->heap, op->type, op->size_max,
+				 op->size_min, op->align, &node[op->slot]);
+			if (ret)
+				fail++;
+			break;
+		case 'f':
+			nvkm_mm_free(&mm, &node[op->slot]);
+			break;
+		default:
+			break;
+		}
+	}
+	time = ktime_to_ns(ktime_get()) - time;
+
+	printf("%d operations over %u slots, %d allocations failed\n",
+	       count, slots, fail);
+	printf("replay: %10.2f ns/op\n", (double)time / count);
+
+	for (i = 0; i < slots; i++)
+		nvkm_mm_free(&mm, &node[i]);
+	ret = nvkm_mm_fini(&mm);
+done:
+	free(node);
+	free(trace);
+	return ret;
+}
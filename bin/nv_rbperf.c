@@ -0,0 +1,142 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <nvif/os.h>
+
+/* keyed the same way as nvkm_client_insert()/nvkm_client_search(), handles
+ * created by a client mostly increase, which is the sequential case
+ */
+struct u_obj {
+	struct rb_node node;
+	u64 handle;
+};
+
+static bool
+u_insert(struct rb_root *root, struct u_obj *obj)
+{
+	struct rb_node **ptr = &root->rb_node;
+	struct rb_node *parent = NULL;
+
+	while (*ptr) {
+		struct u_obj *this = rb_entry(*ptr, typeof(*this), node);
+		parent = *ptr;
+		if (obj->handle < this->handle)
+			ptr = &parent->rb_left;
+		else
+		if (obj->handle > this->handle)
+			ptr = &parent->rb_right;
+		else
+			return false;
+	}
+
+	rb_link_node(&obj->node, parent, ptr);
+	rb_insert_color(&obj->node, root);
+	return true;
+}
+
+static struct u_obj *
+u_search(struct rb_root *root, u64 handle)
+{
+	struct rb_node *node = root->rb_node;
+
+	while (node) {
+		struct u_obj *obj = rb_entry(node, typeof(*obj), node);
+		if (handle < obj->handle)
+			node = node->rb_left;
+		else
+		if (handle > obj->handle)
+			node = node->rb_right;
+		else
+			return obj;
+	}
+
+	return NULL;
+}
+
+static int
+u_depth(struct rb_node *node)
+{
+	int l, r;
+
+	if (!node)
+		return 0;
+	l = u_depth(node->rb_left);
+	r = u_depth(node->rb_right);
+	return 1 + max(l, r);
+}
+
+static int
+u_rbperf(struct u_obj *obj, int count, int loops, bool seq)
+{
+	struct rb_root root = RB_ROOT;
+	s64 insert, search, erase;
+	int i, j, depth;
+
+	srand(1);
+	for (i = 0; i < count; i++) {
+		if (seq)
+			obj[i].handle = i;
+		else
+			obj[i].handle = ((u64)rand() << 31) ^ rand();
+	}
+
+	insert = ktime_to_ns(ktime_get());
+	for (i = 0; i < count; i++) {
+		if (!u_insert(&root, &obj[i]))
+			RB_CLEAR_NODE(&obj[i].node);
+	}
+	insert = ktime_to_ns(ktime_get()) - insert;
+	depth = u_depth(root.rb_node);
+
+	search = ktime_to_ns(ktime_get());
+	for (j = 0; j < loops; j++) {
+		for (i = 0; i < count; i++) {
+			if (!RB_EMPTY_NODE(&obj[i].node) &&
+			    u_search(&root, obj[i].handle) != &obj[i]) {
+				printf("lookup of %016llx failed\n", obj[i].handle);
+				return -EINVAL;
+			}
+		}
+	}
+	search = ktime_to_ns(ktime_get()) - search;
+
+	erase = ktime_to_ns(ktime_get());
+	for (i = 0; i < count; i++) {
+		if (!RB_EMPTY_NODE(&obj[i].node))
+			rb_erase(&obj[i].node, &root);
+	}
+	erase = ktime_to_ns(ktime_get()) - erase;
+
+	printf("%-10s: %d handles, depth %d\n", seq ? "sequential" : "random",
+	       count, depth);
+	printf("insert: %10.2f ns/op\n", (double)insert / count);
+	printf("lookup: %10.2f ns/op\n", (double)search / count / loops);
+	printf("erase : %10.2f ns/op\n", (double)erase / count);
+	return RB_EMPTY_ROOT(&root) ? 0 : -EINVAL;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct u_obj *obj;
+	int count = 100000, loops = 10, ret, c;
+
+	while ((c = getopt(argc, argv, "l:n:")) != -1) {
+		switch (c) {
+		case 'l': loops = strtol(optarg, NULL, 0); break;
+		case 'n': count = strtol(optarg, NULL, 0); break;
+		default:
+			return 1;
+		}
+	}
+
+	if (!(obj = calloc(count, sizeof(*obj))))
+		return 1;
+
+	ret = u_rbperf(obj, count, loops, true);
+	if (ret == 0)
+		ret = u_rbperf(obj, count, loops, false);
+
+	free(obj);
+	return ret;
+}
@@ -3,5 +3,6 @@
 #define NAME    "nv_rd08"
 #define CAST    u8
 #define READ(o) nvif_rd08(&device->object, (o))
+#define READV(a,d,n) nvif_object_rdv(&device->object, 1, (a), (d), (n))
 #define MAIN    main
 #include "nv_rdfunc.h"
@@ -3,5 +3,6 @@
 #define NAME    "nv_rd16"
 #define CAST    u16
 #define READ(o) nvif_rd16(&device->object, (o))
+#define READV(a,d,n) nvif_object_rdv(&device->object, 2, (a), (d), (n))
 #define MAIN    main
 #include "nv_rdfunc.h"
@@ -12,6 +12,21 @@
 
 #include "util.h"
 
+/* registers go down in a batch where the tool has a vectored access path,
+ * anything from the first entry that fails (or everything, without one)
+ * is read with READ() one at a time, so bad addresses are reported just
+ * as they are by the indirect tools
+ */
+#ifndef READV
+#define READV(a,d,n) 0
+#endif
+
+#define READN(a,d,n) do {                                                      \
+	int _i = READV((a), (d), (n));                                         \
+	for (_i = max(_i, 0); _i < (n); _i++)                                  \
+		(d)[_i] = READ((a)[_i]);                                       \
+} while (0)
+
 int
 main(int argc, char **argv)
 {
@@ -24,10 +39,8 @@ main(int argc, char **argv)
 		RATES,
 		WATCH,
 	} mode = NORMAL;
-	struct {
-		u64 addr;
-		u32 data;
-	} *data = NULL;
+	u64 *addr = NULL;
+	u32 *data = NULL, *next = NULL;
 	int mdata = 1;
 	int ndata = 0;
 	int ret, c;
@@ -78,52 +91,58 @@ main(int argc, char **argv)
 			if (ndata + cnt >= mdata) {
 				while (ndata + cnt > mdata)
 					mdata <<= 1;
-				assert(data = realloc(data, sizeof(*data) * mdata));
+				addr = realloc(addr, sizeof(*addr) * mdata);
+				if (!addr)
+					return 1;
 			}
 
-			for (; cnt; cnt--, reg += sizeof(CAST)) {
-				data[ndata].addr = reg;
-				data[ndata].data = READ(reg);
-				ndata++;
-			}
+			for (; cnt; cnt--, reg += sizeof(CAST))
+				addr[ndata++] = reg;
 			break;
 		default:
 			return 1;
 		}
 	}
 
+	data = calloc(mdata, sizeof(*data));
+	next = calloc(mdata, sizeof(*next));
+	if (!data || !next)
+		return 1;
+
+	READN(addr, data, ndata);
+
 	switch (mode) {
 	case NORMAL:
 		for (c = 0; c < ndata; c++) {
 			printf(NAME" "FMTADDR" "FMTDATA"\n",
-			       data[c].addr, data[c].data);
+			       addr[c], (CAST)data[c]);
 		}
 		break;
 	case QUIET:
 		for (c = 0; c < ndata; c++) {
-			printf(FMTDATA"\n", data[c].data);
+			printf(FMTDATA"\n", (CAST)data[c]);
 		}
 		break;
 	case RATES:
 		while (1) {
+			READN(addr, next, ndata);
 			for (c = 0; c < ndata; c++) {
-				CAST next = READ(data[c].addr);
 				printf(NAME" "FMTADDR" "FMTDATA" "FMTDATA" %d/s\n",
-				       data[c].addr, data[c].data, next,
-				       next - data[c].data);
-				data[c].data = next;
+				       addr[c], (CAST)data[c], (CAST)next[c],
+				       next[c] - data[c]);
+				data[c] = next[c];
 			}
 			sleep(1);
 		}
 		break;
 	case WATCH:
 		while (1) {
+			READN(addr, next, ndata);
 			for (c = 0; c < ndata; c++) {
-				CAST next = READ(data[c].addr);
-				if (next != data[c].data) {
+				if (next[c] != data[c]) {
 					printf(NAME" "FMTADDR" "FMTDATA"\n",
-					       data[c].addr, next);
-					data[c].data = next;
+					       addr[c], (CAST)next[c]);
+					data[c] = next[c];
 				}
 			}
 		}
@@ -133,7 +152,9 @@ main(int argc, char **argv)
 		return 1;
 	}
 
+	free(next);
 	free(data);
+	free(addr);
 	nvif_device_fini(device);
 	nvif_client_fini(&client);
 	return 0;
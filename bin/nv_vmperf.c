@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <nvif/client.h>
+#include <nvif/device.h>
+#include <nvif/class.h>
+
+#include <subdev/fb.h>
+#include <subdev/mmu.h>
+
+#include "util.h"
+
+static double
+mibps(u64 size, int loops, s64 time)
+{
+	return ((double)size * loops / (1024 * 1024)) / ((double)time / 1e9);
+}
+
+/* the ptes written here point at VRAM offset 0 (or a fake dma address list
+ * with -S), but the vm is never bound to a channel, so nothing ever goes
+ * through them
+ */
+static int
+u_vmperf(struct nvkm_vm *vm, u8 shift, u64 size, int loops, bool sys)
+{
+	struct nvkm_mm_node node = { .offset = 0, .length = size >> 12 };
+	struct nvkm_mem mem = { .size = size >> 12 };
+	struct nvkm_mmu *mmu = vm->mmu;
+	struct nvkm_vma vma = {};
+	u8 page = shift ? shift : 12;
+	s64 map, unmap, total, big;
+	u64 hit, miss, grace, i;
+	int ret;
+
+	INIT_LIST_HEAD(&mem.regions);
+	list_add(&node.rl_entry, &mem.regions);
+
+	if (sys) {
+		if (!(mem.pages = malloc((size >> 12) * sizeof(*mem.pages))))
+			return -ENOMEM;
+		for (i = 0; i < size >> 12; i++)
+			mem.pages[i] = i << 12;
+	}
+
+	mutex_lock(&mmu->pool.mutex);
+	hit = mmu->pool.hit;
+	miss = mmu->pool.miss;
+	grace = mmu->pool.grace;
+	mutex_unlock(&mmu->pool.mutex);
+
+	ret = nvkm_vm_get(vm, size, shift, NV_MEM_ACCESS_RW, &vma);
+	if (ret) {
+		printf("failed to allocate %lld bytes of vm, %d\n", size, ret);
+		goto done;
+	}
+
+	total = atomic64_read(&mmu->mapped.total);
+	big = atomic64_read(&mmu->mapped.big);
+	map = unmap = 0;
+	for (i = 0; i < loops; i++) {
+		s64 t0 = ktime_to_ns(ktime_get()), t1, t2;
+		nvkm_vm_map(&vma, &mem);
+		t1 = ktime_to_ns(ktime_get());
+		nvkm_vm_unmap(&vma);
+		t2 = ktime_to_ns(ktime_get());
+		map += t1 - t0;
+		unmap += t2 - t1;
+	}
+
+	total = atomic64_read(&mmu->mapped.total) - total;
+	big = atomic64_read(&mmu->mapped.big) - big;
+
+	if (shift == NVKM_VM_PAGE_AUTO)
+		printf("auto pages, ");
+	else
+		printf("%3dKiB pages, ", (1 << shift) / 1024);
+	printf("%s, %lld bytes x %d, %.1f%% big\n", sys ? "host" : "vram",
+	       size, loops, total ? 100.0 * big / total : 0.0);
+	printf("map  : %10.2f MiB/s %10.2f ns/pte\n", mibps(size, loops, map),
+	       (double)map / loops / (size >> page));
+	printf("unmap: %10.2f MiB/s %10.2f ns/pte\n", mibps(size, loops, unmap),
+	       (double)unmap / loops / (size >> page));
+
+	nvkm_vm_put(&vma);
+
+	/* page tables for the vma, taken from the pool or reclaimed from
+	 * the previous run while still within their grace period
+	 */
+	mutex_lock(&mmu->pool.mutex);
+	printf("pgt  : %10lld hit %10lld miss %10lld grace\n",
+	       mmu->pool.hit - hit, mmu->pool.miss - miss,
+	       mmu->pool.grace - grace);
+	mutex_unlock(&mmu->pool.mutex);
+done:
+	free(mem.pages);
+	return ret;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct nvif_client client;
+	struct nvif_device device;
+	struct nvkm_mmu *mmu;
+	struct nvkm_vm *vm = NULL;
+	u64 size = 256 * 1024 * 1024;
+	int loops = 16, ret, c;
+	bool sys = false;
+
+	while ((c = getopt(argc, argv, "l:s:S"U_GETOPT)) != -1) {
+		switch (c) {
+		case 'l': loops = strtol(optarg, NULL, 0); break;
+		case 's': size = strtoull(optarg, NULL, 0); break;
+		case 'S': sys = true; break;
+		default:
+			if (!u_option(c))
+				return 1;
+			break;
+		}
+	}
+
+	ret = u_device("lib", argv[0], "error", true, true, ~0ULL,
+		       0x00000000, &client, &device);
+	if (ret)
+		return ret;
+
+	if (!(mmu = nvxx_device(&device)->mmu)) {
+		ret = -ENODEV;
+		goto fini;
+	}
+
+	ret = nvkm_vm_new(nvxx_device(&device), 0, mmu->limit, 0, NULL, &vm);
+	if (ret) {
+		printf("failed to create vm, %d\n", ret);
+		goto fini;
+	}
+
+	/* dma address lists are always mapped with small pages */
+	size &= ~((1ULL << mmu->lpg_shift) - 1);
+	ret = u_vmperf(vm, 12, size, loops, sys);
+	if (ret == 0 && !sys && mmu->lpg_shift != 12) {
+		ret = u_vmperf(vm, mmu->lpg_shift, size, loops, sys);
+		if (ret == 0)
+			ret = u_vmperf(vm, NVKM_VM_PAGE_AUTO, size, loops, sys);
+	}
+
+	nvkm_vm_ref(NULL, &vm, NULL);
+fini:
+	nvif_device_fini(&device);
+	nvif_client_fini(&client);
+	return ret;
+}
@@ -3,5 +3,6 @@
 #define NAME       "nv_wr32"
 #define CAST       u32
 #define WRITE(o,v) nvif_wr32(&device->object, (o), (v))
+#define WRITEV(a,d,n) nvif_object_wrv(&device->object, 4, (a), (d), (n))
 #define MAIN       main
 #include "nv_wrfunc.h"
@@ -12,6 +12,20 @@
 
 #include "util.h"
 
+/* registers go down in a batch where the tool has a vectored access path,
+ * anything from the first entry that fails (or everything, without one)
+ * is written with WRITE() one at a time, as the indirect tools do
+ */
+#ifndef WRITEV
+#define WRITEV(a,d,n) 0
+#endif
+
+#define WRITEN(a,d,n) do {                                                     \
+	int _i = WRITEV((a), (d), (n));                                        \
+	for (_i = max(_i, 0); _i < (n); _i++)                                  \
+		WRITE((a)[_i], (d)[_i]);                                       \
+} while (0)
+
 int
 MAIN(int argc, char **argv)
 {
@@ -19,6 +33,10 @@ MAIN(int argc, char **argv)
 	struct nvif_device _device, *device = &_device;
 	char *rstr = NULL;
 	char *vstr = NULL;
+	u64 *addr = NULL;
+	u32 *data = NULL;
+	int mdata = 1;
+	int ndata = 0;
 	int quiet = 0;
 	int ret, c;
 
@@ -78,10 +96,21 @@ MAIN(int argc, char **argv)
 		case ',':
 			rstr++;
 		case '\0':
+			if (ndata + cnt >= mdata) {
+				while (ndata + cnt > mdata)
+					mdata <<= 1;
+				addr = realloc(addr, sizeof(*addr) * mdata);
+				data = realloc(data, sizeof(*data) * mdata);
+				if (!addr || !data)
+					return 1;
+			}
+
 			while (cnt--) {
 				if (!quiet)
 					printk(NAME" "FMTADDR" "FMTDATA"\n", reg, (CAST)val);
-				WRITE(reg, val);
+				addr[ndata] = reg;
+				data[ndata] = (CAST)val;
+				ndata++;
 				reg += sizeof(CAST);
 			}
 			break;
@@ -90,6 +119,11 @@ MAIN(int argc, char **argv)
 		}
 	}
 
+	WRITEN(addr, data, ndata);
+
+	free(data);
+	free(addr);
+
 	nvif_device_fini(device);
 	nvif_client_fini(&client);
 	return 0;
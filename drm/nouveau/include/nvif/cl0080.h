@@ -9,6 +9,7 @@ struct nv_device_v0 {
 
 #define NV_DEVICE_V0_INFO                                                  0x00
 #define NV_DEVICE_V0_TIME                                                  0x01
+#define NV_DEVICE_V0_SUBDEV_STATS                                          0x02
 
 struct nv_device_info_v0 {
 	__u8  version;
@@ -43,4 +44,25 @@ struct nv_device_time_v0 {
 	__u8  pad01[7];
 	__u64 time;
 };
+
+struct nv_device_subdev_stats_v0 {
+	__u8  version;
+	__u8  count;
+	__u8  pad02[6];
+	struct nv_device_subdev_stats_entry_v0 {
+		__u8  index;
+		__u8  pad01[7];
+		char  name[16];
+#define NV_DEVICE_SUBDEV_STATS_V0_PREINIT                                  0x00
+#define NV_DEVICE_SUBDEV_STATS_V0_ONEINIT                                  0x01
+#define NV_DEVICE_SUBDEV_STATS_V0_INIT                                     0x02
+#define NV_DEVICE_SUBDEV_STATS_V0_FINI                                     0x03
+		struct {
+			__u64 time;	/* us */
+			__u64 wait;	/* ns spent in nvkm_[num]sec() */
+			__u64 rd;
+			__u64 wr;
+		} stat[4];
+	} entry[];
+};
 #endif
@@ -2,6 +2,7 @@
 #define __NVIF_IF0000_H__
 
 #define NV_CLIENT_DEVLIST                                                  0x00
+#define NV_CLIENT_IOCTL_STATS                                              0x01
 
 struct nv_client_devlist_v0 {
 	__u8  version;
@@ -9,4 +10,29 @@ struct nv_client_devlist_v0 {
 	__u8  pad02[6];
 	__u64 device[];
 };
+
+#define NV_CLIENT_IOCTL_STATS_V0_HIST                                        24
+
+struct nv_client_ioctl_stats_v0 {
+	__u8  version;
+#define NV_CLIENT_IOCTL_STATS_V0_ENABLE                                    0x01
+#define NV_CLIENT_IOCTL_STATS_V0_DISABLE                                   0x02
+#define NV_CLIENT_IOCTL_STATS_V0_RESET                                     0x04
+	__u8  flags;
+	__u8  enabled;
+	__u8  pad03;
+	__u32 count;
+	struct nv_client_ioctl_stats_entry_v0 {
+		__u8  type;
+#define NV_CLIENT_IOCTL_STATS_V0_ENTRY_MTHD                                0x01
+#define NV_CLIENT_IOCTL_STATS_V0_ENTRY_OTHER                               0x02
+		__u8  flags;
+		__u8  method;
+		__u8  pad03;
+		__s32 oclass;
+		__u64 count;
+		__u64 time;
+		__u32 hist[NV_CLIENT_IOCTL_STATS_V0_HIST];
+	} entry[];
+};
 #endif
@@ -18,6 +18,8 @@ struct nvif_ioctl_v0 {
 #define NVIF_IOCTL_V0_NTFY_DEL                                             0x0a
 #define NVIF_IOCTL_V0_NTFY_GET                                             0x0b
 #define NVIF_IOCTL_V0_NTFY_PUT                                             0x0c
+#define NVIF_IOCTL_V0_RDV                                                  0x0d
+#define NVIF_IOCTL_V0_WRV                                                  0x0e
 	__u8  type;
 	__u8  pad02[4];
 #define NVIF_IOCTL_V0_OWNER_NVIF                                           0x00
@@ -80,6 +82,32 @@ struct nvif_ioctl_wr_v0 {
 	__u64 addr;
 };
 
+struct nvif_ioctl_rdv_v0 {
+	/* nvif_ioctl ... */
+	__u8  version;
+	__u8  pad01[3];
+	__u32 count;
+	struct nvif_ioctl_rdv_reg_v0 {
+		__u8  size;
+		__u8  pad01[3];
+		__u32 data;
+		__u64 addr;
+	} reg[];
+};
+
+struct nvif_ioctl_wrv_v0 {
+	/* nvif_ioctl ... */
+	__u8  version;
+	__u8  pad01[3];
+	__u32 count;
+	struct nvif_ioctl_wrv_reg_v0 {
+		__u8  size;
+		__u8  pad01[3];
+		__u32 data;
+		__u64 addr;
+	} reg[];
+};
+
 struct nvif_ioctl_map_v0 {
 	/* nvif_ioctl ... */
 	__u8  version;
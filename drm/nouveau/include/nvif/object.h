@@ -28,6 +28,8 @@ int  nvif_object_sclass_get(struct nvif_object *, struct nvif_sclass **);
 void nvif_object_sclass_put(struct nvif_sclass **);
 u32  nvif_object_rd(struct nvif_object *, int, u64);
 void nvif_object_wr(struct nvif_object *, int, u64, u32);
+int  nvif_object_rdv(struct nvif_object *, int, const u64 *, u32 *, int);
+int  nvif_object_wrv(struct nvif_object *, int, const u64 *, const u32 *, int);
 int  nvif_object_mthd(struct nvif_object *, u32, void *, u32);
 int  nvif_object_map(struct nvif_object *);
 void nvif_object_unmap(struct nvif_object *);
@@ -12,6 +12,13 @@ struct nvkm_client {
 	struct rb_root objroot;
 	struct rb_root dmaroot;
 
+	/* ioctls that modify the object tree (or client state) take this
+	 * for write, everything else only for read; methods are further
+	 * serialised per-engine (or per-object) by the hashed mutexes
+	 */
+	struct rw_semaphore lock;
+	struct mutex mthd[16];
+
 	bool super;
 	void *data;
 	int (*ntfy)(const void *, u32, const void *, u32);
@@ -84,6 +84,7 @@ struct nvkm_device {
 	const char *dbgopt;
 
 	struct list_head head;
+	bool ready; /* constructed, visible to nvkm_device_find() */
 	struct mutex mutex;
 	int refcount;
 
@@ -94,6 +95,16 @@ struct nvkm_device {
 	u64 disable_mask;
 	u32 debug;
 
+	/* subdev stages being timed, register accesses and time spent
+	 * polling in nvkm_[num]sec() are charged to the innermost stage
+	 * running on the same task, and aren't counted at all otherwise
+	 */
+	struct {
+		atomic_t stat;
+		spinlock_t lock;
+		struct list_head list;
+	} mmio;
+
 	const struct nvkm_device_chip *chip;
 	enum {
 		NV_04    = 0x04,
@@ -235,13 +246,35 @@ struct nvkm_device_chip {
 struct nvkm_device *nvkm_device_find(u64 name);
 int nvkm_device_list(u64 *name, int size);
 
+struct nvkm_device_mmio_stat {
+	struct list_head head;
+	struct task_struct *task;
+	u64 rd;
+	u64 wr;
+	u64 wait;
+};
+
+void nvkm_device_mmio_stat(struct nvkm_device *, u64 rd, u64 wr, u64 wait);
+
 /* privileged register interface accessor macros */
-#define nvkm_rd08(d,a) ioread8((d)->pri + (a))
-#define nvkm_rd16(d,a) ioread16_native((d)->pri + (a))
-#define nvkm_rd32(d,a) ioread32_native((d)->pri + (a))
-#define nvkm_wr08(d,a,v) iowrite8((v), (d)->pri + (a))
-#define nvkm_wr16(d,a,v) iowrite16_native((v), (d)->pri + (a))
-#define nvkm_wr32(d,a,v) iowrite32_native((v), (d)->pri + (a))
+#define nvkm_rd_(d,a,f) ({                                                     \
+	struct nvkm_device *_rdev = (d);                                       \
+	if (unlikely(atomic_read(&_rdev->mmio.stat)))                          \
+		nvkm_device_mmio_stat(_rdev, 1, 0, 0);                         \
+	f(_rdev->pri + (a));                                                   \
+})
+#define nvkm_wr_(d,a,v,f) ({                                                   \
+	struct nvkm_device *_wdev = (d);                                       \
+	if (unlikely(atomic_read(&_wdev->mmio.stat)))                          \
+		nvkm_device_mmio_stat(_wdev, 0, 1, 0);                         \
+	f((v), _wdev->pri + (a));                                              \
+})
+#define nvkm_rd08(d,a) nvkm_rd_((d), (a), ioread8)
+#define nvkm_rd16(d,a) nvkm_rd_((d), (a), ioread16_native)
+#define nvkm_rd32(d,a) nvkm_rd_((d), (a), ioread32_native)
+#define nvkm_wr08(d,a,v) nvkm_wr_((d), (a), (v), iowrite8)
+#define nvkm_wr16(d,a,v) nvkm_wr_((d), (a), (v), iowrite16_native)
+#define nvkm_wr32(d,a,v) nvkm_wr_((d), (a), (v), iowrite32_native)
 #define nvkm_mask(d,a,m,v) ({                                                  \
 	struct nvkm_device *_device = (d);                                     \
 	u32 _addr = (a), _temp = nvkm_rd32(_device, _addr);                    \
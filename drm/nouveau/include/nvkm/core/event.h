@@ -12,10 +12,24 @@ struct nvkm_event {
 
 	spinlock_t refs_lock;
 	spinlock_t list_lock;
-	struct list_head list;
+	struct list_head *list;
 	int *refs;
 };
 
+/* Notifiers are bucketed by index, and by type for those that only ask
+ * for a single one, so nvkm_event_send() only walks what can match.
+ * Each index has an extra bucket at types_nr for multi-type notifiers.
+ */
+static inline struct list_head *
+nvkm_event_list(struct nvkm_event *event, u32 types, int index)
+{
+	int type = event->types_nr;
+	if (!WARN_ON(types & ~GENMASK(event->types_nr - 1, 0)) &&
+	    hweight32(types) == 1)
+		type = __ffs(types);
+	return &event->list[index * (event->types_nr + 1) + type];
+}
+
 struct nvkm_event_func {
 	int  (*ctor)(struct nvkm_object *, void *data, u32 size,
 		     struct nvkm_notify *);
@@ -2,6 +2,10 @@
 #define __NVKM_IOCTL_H__
 #include <core/os.h>
 struct nvkm_client;
+struct nv_client_ioctl_stats_entry_v0;
 
 int nvkm_ioctl(struct nvkm_client *, bool, void *, u32, void **);
+int nvkm_ioctl_stats(u8 flags, bool *enabled,
+		     struct nv_client_ioctl_stats_entry_v0 *, u32 count);
+void nvkm_ioctl_stats_fini(void);
 #endif
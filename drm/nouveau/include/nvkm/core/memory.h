@@ -25,6 +25,9 @@ struct nvkm_memory_func {
 	void (*release)(struct nvkm_memory *);
 	u32 (*rd32)(struct nvkm_memory *, u64 offset);
 	void (*wr32)(struct nvkm_memory *, u64 offset, u32 data);
+	void (*rd)(struct nvkm_memory *, u64 offset, void *data, u64 size);
+	void (*wr)(struct nvkm_memory *, u64 offset, const void *data, u64 size);
+	void (*fill)(struct nvkm_memory *, u64 offset, u32 data, u64 size);
 	void (*map)(struct nvkm_memory *, struct nvkm_vma *, u64 offset);
 };
 
@@ -50,4 +53,38 @@ void nvkm_memory_del(struct nvkm_memory **);
 	_data;                                                                 \
 })
 #define nvkm_done(o)     (o)->func->release(o)
+
+/* span accessors, sizes are in bytes and a multiple of 4 - backends that
+ * don't provide them fall back to a loop over the 32-bit accessors
+ */
+#define nvkm_ro(o,a,p,s) do {                                                  \
+	typeof(o) _o = (o);                                                    \
+	u64 _a = (a), _s = (s), _i;                                            \
+	u32 *_p = (p);                                                         \
+	if (_o->func->rd)                                                      \
+		_o->func->rd(_o, _a, _p, _s);                                  \
+	else                                                                   \
+		for (_i = 0; _i < _s; _i += 4)                                 \
+			_p[_i / 4] = nvkm_ro32(_o, _a + _i);                   \
+} while (0)
+#define nvkm_wo(o,a,p,s) do {                                                  \
+	typeof(o) _o = (o);                                                    \
+	u64 _a = (a), _s = (s), _i;                                            \
+	const u32 *_p = (p);                                                   \
+	if (_o->func->wr)                                                      \
+		_o->func->wr(_o, _a, _p, _s);                                  \
+	else                                                                   \
+		for (_i = 0; _i < _s; _i += 4)                                 \
+			nvkm_wo32(_o, _a + _i, _p[_i / 4]);                    \
+} while (0)
+#define nvkm_fo32(o,a,d,s) do {                                                \
+	typeof(o) _o = (o);                                                    \
+	u64 _a = (a), _s = (s), _i;                                            \
+	u32 _d = (d);                                                          \
+	if (_o->func->fill)                                                    \
+		_o->func->fill(_o, _a, _d, _s);                                \
+	else                                                                   \
+		for (_i = 0; _i < _s; _i += 4)                                 \
+			nvkm_wo32(_o, _a + _i, _d);                            \
+} while (0)
 #endif
@@ -4,7 +4,8 @@
 
 struct nvkm_mm_node {
 	struct list_head nl_entry;
-	struct list_head fl_entry;
+	struct rb_node fl_node;
+	u32 fl_max; /* largest free length in fl_node's subtree */
 	struct list_head rl_entry;
 
 #define NVKM_MM_HEAP_ANY 0x00
@@ -18,7 +19,7 @@ struct nvkm_mm_node {
 
 struct nvkm_mm {
 	struct list_head nodes;
-	struct list_head free;
+	struct rb_root free;
 
 	u32 block_size;
 	int heap_nodes;
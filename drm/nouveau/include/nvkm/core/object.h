@@ -19,6 +19,9 @@ struct nvkm_object {
 	u64 token;
 	u64 object;
 	struct rb_node node;
+
+	/* children's classes, filled on first use, see nvkm_object_sclass() */
+	struct nvkm_object_sclass *sclass;
 };
 
 struct nvkm_object_func {
@@ -61,6 +64,10 @@ int nvkm_object_wr16(struct nvkm_object *, u64 addr, u16  data);
 int nvkm_object_wr32(struct nvkm_object *, u64 addr, u32  data);
 int nvkm_object_bind(struct nvkm_object *, struct nvkm_gpuobj *, int align,
 		     struct nvkm_gpuobj **);
+int nvkm_object_sclass(struct nvkm_object *, int index, struct nvkm_oclass *);
+int nvkm_object_sclass_find(struct nvkm_object *, s32 oclass,
+			    struct nvkm_oclass *);
+void nvkm_object_sclass_flush(void);
 
 struct nvkm_sclass {
 	int minver;
@@ -14,6 +14,16 @@ struct nvkm_ramht {
 	struct nvkm_gpuobj *gpuobj;
 	int size;
 	int bits;
+
+	/* host-side (chid, handle) -> slot index, open-addressed */
+	int *index;
+	u32 index_mask;
+	int index_tomb;
+
+	int used;
+	int peak;
+	int probe; /* longest walk from hash origin that HW may have to do */
+
 	struct nvkm_ramht_data data[];
 };
 
@@ -10,6 +10,18 @@ struct nvkm_subdev {
 	u32 debug;
 
 	bool oneinit;
+
+	/* most recent preinit/oneinit/init/fini, see nvkm_subdev_stat_end() */
+	struct nvkm_subdev_stat {
+		s64 time;
+		u64 wait;
+		u64 rd;
+		u64 wr;
+	} stat[4];
+#define NVKM_SUBDEV_STAT_PREINIT 0
+#define NVKM_SUBDEV_STAT_ONEINIT 1
+#define NVKM_SUBDEV_STAT_INIT    2
+#define NVKM_SUBDEV_STAT_FINI    3
 };
 
 struct nvkm_subdev_func {
@@ -22,6 +22,7 @@ struct nvkm_vma {
 	struct nvkm_mm_node *node;
 	u64 offset;
 	u32 access;
+	bool mixed; /* NVKM_VM_PAGE_AUTO, both page tables referenced */
 };
 
 struct nvkm_vm {
@@ -37,12 +38,28 @@ struct nvkm_vm {
 	struct nvkm_vm_pgt *pgt;
 	u32 fpde;
 	u32 lpde;
+
+	/* page tables that have lost their last user, which are left in
+	 * place for a grace period in case the range is reused, oldest
+	 * first - protected by mutex
+	 */
+	struct nvkm_vm_idle {
+		u32 pde;
+		int big;
+		unsigned long time;
+	} idle[16];
+	int idle_nr;
 };
 
 int  nvkm_vm_new(struct nvkm_device *, u64 offset, u64 length, u64 mm_offset,
 		 struct lock_class_key *, struct nvkm_vm **);
 int  nvkm_vm_ref(struct nvkm_vm *, struct nvkm_vm **, struct nvkm_gpuobj *pgd);
 int  nvkm_vm_boot(struct nvkm_vm *, u64 size);
+/* page_shift for nvkm_vm_get() to pick the page size of each part of the
+ * mapping from the memory behind it, where the mmu supports that
+ */
+#define NVKM_VM_PAGE_AUTO 0
+
 int  nvkm_vm_get(struct nvkm_vm *, u64 size, u32 page_shift, u32 access,
 		 struct nvkm_vma *);
 void nvkm_vm_put(struct nvkm_vma *);
@@ -51,6 +68,16 @@ void nvkm_vm_map_at(struct nvkm_vma *, u64 offset, struct nvkm_mem *);
 void nvkm_vm_unmap(struct nvkm_vma *);
 void nvkm_vm_unmap_at(struct nvkm_vma *, u64 offset, u64 length);
 
+/* the map/unmap functions above each finish with a tlb invalidate of the
+ * whole vm, the _defer variants leave it to the caller, which must call
+ * nvkm_vm_flush() itself before relying on the update (or releasing the
+ * memory that was unmapped), so several vmas can be updated for the cost
+ * of a single invalidate
+ */
+void nvkm_vm_map_defer(struct nvkm_vma *, struct nvkm_mem *);
+void nvkm_vm_unmap_defer(struct nvkm_vma *);
+void nvkm_vm_flush(struct nvkm_vm *);
+
 struct nvkm_mmu {
 	const struct nvkm_mmu_func *func;
 	struct nvkm_subdev subdev;
@@ -58,6 +85,24 @@ struct nvkm_mmu {
 	u64 limit;
 	u8  dma_bits;
 	u8  lpg_shift;
+
+	/* zeroed page tables of each size, shared by all vms */
+	struct {
+		struct mutex mutex;
+		struct nvkm_memory *mem[2][8];
+		int nr[2];
+		u64 hit;   /* taken from the pool */
+		u64 miss;  /* pool empty, newly allocated */
+		u64 grace; /* idle page table reclaimed within its grace period */
+	} pool;
+
+	/* bytes mapped over the mmu's lifetime, and how many of those used
+	 * big pages
+	 */
+	struct {
+		atomic64_t total;
+		atomic64_t big;
+	} mapped;
 };
 
 int nv04_mmu_new(struct nvkm_device *, int, struct nvkm_mmu **);
@@ -47,6 +47,8 @@ void nvkm_timer_alarm_cancel(struct nvkm_timer *, struct nvkm_alarm *);
 		cond                                                           \
 	} while (_taken = nvkm_timer_read(_tmr) - _time0, _taken < _nsecs);    \
                                                                                \
+	if (unlikely(atomic_read(&_device->mmio.stat)))                        \
+		nvkm_device_mmio_stat(_device, 0, 0, _taken);                  \
 	if (_taken >= _nsecs) {                                                \
 		if (_warn) {                                                   \
 			dev_warn(_device->dev, "timeout at %s:%d/%s()!\n",     \
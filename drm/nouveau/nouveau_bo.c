@@ -1013,8 +1013,9 @@ nouveau_bo_move_prep(struct nouveau_drm *drm, struct ttm_buffer_object *bo,
 		return ret;
 	}
 
-	nvkm_vm_map(&old_node->vma[0], old_node);
-	nvkm_vm_map(&old_node->vma[1], new_node);
+	nvkm_vm_map_defer(&old_node->vma[0], old_node);
+	nvkm_vm_map_defer(&old_node->vma[1], new_node);
+	nvkm_vm_flush(drm->client.vm);
 	return 0;
 }
 
@@ -1584,10 +1585,17 @@ nouveau_bo_vma_add(struct nouveau_bo *nvbo, struct nvkm_vm *vm,
 		   struct nvkm_vma *vma)
 {
 	const u32 size = nvbo->bo.mem.num_pages << PAGE_SHIFT;
+	u32 page_shift = nvbo->page_shift;
 	int ret;
 
-	ret = nvkm_vm_get(vm, size, nvbo->page_shift,
-			     NV_MEM_ACCESS_RW, vma);
+	/* let the vm use big pages for whatever parts of the bo's vram
+	 * happen to be contiguous enough, a bo smaller than a big page
+	 * never has any, and would only waste big-page-aligned va on it
+	 */
+	if (page_shift == 12 && size >= (1 << vm->mmu->lpg_shift))
+		page_shift = NVKM_VM_PAGE_AUTO;
+
+	ret = nvkm_vm_get(vm, size, page_shift, NV_MEM_ACCESS_RW, vma);
 	if (ret)
 		return ret;
 
@@ -35,6 +35,7 @@
 #include "drm_crtc_helper.h"
 
 #include <core/gpuobj.h>
+#include <core/ioctl.h>
 #include <core/option.h>
 #include <core/pci.h>
 #include <core/tegra.h>
@@ -1125,6 +1126,8 @@ nouveau_drm_exit(void)
 #ifdef CONFIG_NOUVEAU_PLATFORM_DRIVER
 	platform_driver_unregister(&nouveau_platform_driver);
 #endif
+
+	nvkm_ioctl_stats_fini();
 }
 
 module_init(nouveau_drm_init);
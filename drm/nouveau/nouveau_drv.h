@@ -90,6 +90,9 @@ struct nouveau_cli {
 	void *abi16;
 	struct list_head objects;
 	struct list_head notifys;
+	struct rw_semaphore usif;
+	void *usif_arena;
+	unsigned long usif_arena_busy;
 	char name[32];
 	struct drm_device *dev;
 };
@@ -51,15 +51,25 @@ nouveau_vram_manager_fini(struct ttm_mem_type_manager *man)
 static inline void
 nvkm_mem_node_cleanup(struct nvkm_mem *node)
 {
-	if (node->vma[0].node) {
-		nvkm_vm_unmap(&node->vma[0]);
-		nvkm_vm_put(&node->vma[0]);
-	}
-
-	if (node->vma[1].node) {
-		nvkm_vm_unmap(&node->vma[1]);
-		nvkm_vm_put(&node->vma[1]);
-	}
+	struct nvkm_vma *vma = node->vma;
+
+	/* these are the temporary mappings from nouveau_bo_move_prep(),
+	 * which normally share a vm, so invalidate it once for both
+	 */
+	if (vma[0].node)
+		nvkm_vm_unmap_defer(&vma[0]);
+	if (vma[1].node)
+		nvkm_vm_unmap_defer(&vma[1]);
+
+	if (vma[0].node)
+		nvkm_vm_flush(vma[0].vm);
+	if (vma[1].node && (!vma[0].node || vma[1].vm != vma[0].vm))
+		nvkm_vm_flush(vma[1].vm);
+
+	if (vma[0].node)
+		nvkm_vm_put(&vma[0]);
+	if (vma[1].node)
+		nvkm_vm_put(&vma[1]);
 }
 
 static void
@@ -292,17 +292,103 @@ usif_object_new(struct drm_file *f, void *data, u32 size, void *argv, u32 argc)
 	return ret;
 }
 
+/* Argument buffers: small ioctls (register access, notify get/put, most
+ * methods) are handled on the stack, larger ones use a page kept around
+ * per-client, which is only ever lent to one ioctl at a time.  Anything
+ * bigger, or arriving while the page is lent out, is kmalloc()'d.
+ */
+#define USIF_ARGS_STACK 128
+#define USIF_ARGS_ARENA PAGE_SIZE
+
+static void *
+usif_args_get(struct nouveau_cli *cli, void *stack, u32 size)
+{
+	if (size <= USIF_ARGS_STACK)
+		return stack;
+
+	if (size <= USIF_ARGS_ARENA &&
+	    !test_and_set_bit_lock(0, &cli->usif_arena_busy)) {
+		if (!cli->usif_arena)
+			cli->usif_arena = kmalloc(USIF_ARGS_ARENA, GFP_KERNEL);
+		if (cli->usif_arena)
+			return cli->usif_arena;
+		clear_bit_unlock(0, &cli->usif_arena_busy);
+	}
+
+	return kmalloc(size, GFP_KERNEL);
+}
+
+static void
+usif_args_put(struct nouveau_cli *cli, void *stack, void *args)
+{
+	if (args == stack)
+		return;
+	if (args && args == cli->usif_arena) {
+		clear_bit_unlock(0, &cli->usif_arena_busy);
+		return;
+	}
+	kfree(args);
+}
+
+/* Size of the part of the arguments an ioctl returns anything in, the rest
+ * is input-only and needn't be copied back.
+ */
+static u32
+usif_args_reply(u8 type, u32 argc)
+{
+	switch (type) {
+	case NVIF_IOCTL_V0_WR:
+	case NVIF_IOCTL_V0_DEL:
+	case NVIF_IOCTL_V0_UNMAP:
+	case NVIF_IOCTL_V0_NTFY_DEL:
+	case NVIF_IOCTL_V0_NTFY_GET:
+	case NVIF_IOCTL_V0_NTFY_PUT:
+		return sizeof(struct nvif_ioctl_v0);
+	case NVIF_IOCTL_V0_RD:
+		return min_t(u32, argc, sizeof(struct nvif_ioctl_v0) +
+					sizeof(struct nvif_ioctl_rd_v0));
+	case NVIF_IOCTL_V0_WRV:
+		/* count, which is the failing entry on error */
+		return min_t(u32, argc, sizeof(struct nvif_ioctl_v0) +
+					sizeof(struct nvif_ioctl_wrv_v0));
+	default:
+		return argc;
+	}
+}
+
+/* ioctls that don't touch usif state, or the abi16/nvkm client state that's
+ * protected by cli->mutex, and can run concurrently
+ */
+static bool
+usif_ioctl_shared(u8 type)
+{
+	switch (type) {
+	case NVIF_IOCTL_V0_NOP:
+	case NVIF_IOCTL_V0_SCLASS:
+	case NVIF_IOCTL_V0_MTHD:
+	case NVIF_IOCTL_V0_RD:
+	case NVIF_IOCTL_V0_WR:
+	case NVIF_IOCTL_V0_RDV:
+	case NVIF_IOCTL_V0_WRV:
+		return true;
+	default:
+		return false;
+	}
+}
+
 int
 usif_ioctl(struct drm_file *filp, void __user *user, u32 argc)
 {
 	struct nouveau_cli *cli = nouveau_cli(filp);
 	struct nvif_client *client = &cli->base;
-	void *data = kmalloc(argc, GFP_KERNEL);
+	u64   stack[USIF_ARGS_STACK / sizeof(u64)];
+	void *data = usif_args_get(cli, stack, argc);
 	u32   size = argc;
 	union {
 		struct nvif_ioctl_v0 v0;
 	} *argv = data;
 	struct usif_object *object;
+	bool shared;
 	u8 owner;
 	int ret;
 
@@ -321,10 +407,19 @@ usif_ioctl(struct drm_file *filp, void __user *user, u32 argc)
 	} else
 		goto done;
 
+	/* Shared ioctls rely on the nvkm client's own locking, and only need
+	 * to keep the usif object they're routed through from being freed
+	 * by a concurrent DEL.
+	 */
+	shared = !argv->v0.route && usif_ioctl_shared(argv->v0.type);
+	if (shared)
+		down_read(&cli->usif);
+	else
+		mutex_lock(&cli->mutex);
+
 	/* USIF slightly abuses some return-only ioctl members in order
 	 * to provide interoperability with the older ABI16 objects
 	 */
-	mutex_lock(&cli->mutex);
 	if (argv->v0.route) {
 		if (ret = -EINVAL, argv->v0.route == 0xff)
 			ret = nouveau_abi16_usif(filp, argv, argc);
@@ -351,7 +446,12 @@ usif_ioctl(struct drm_file *filp, void __user *user, u32 argc)
 		ret = usif_notify_put(filp, data, size, argv, argc);
 		break;
 	default:
-		ret = nvif_client_ioctl(client, argv, argc);
+		/* never as supervisor, shared ioctls don't hold cli->mutex and
+		 * could otherwise see client->super while it's raised for an
+		 * abi16 channel/notifier allocation
+		 */
+		ret = client->driver->ioctl(client->object.priv, false,
+					    argv, argc, NULL);
 		break;
 	}
 	if (argv->v0.route == NVDRM_OBJECT_USIF) {
@@ -359,20 +459,25 @@ usif_ioctl(struct drm_file *filp, void __user *user, u32 argc)
 		argv->v0.route = object->route;
 		argv->v0.token = object->token;
 		if (ret == 0 && argv->v0.type == NVIF_IOCTL_V0_DEL) {
+			down_write(&cli->usif);
 			list_del(&object->head);
 			kfree(object);
+			up_write(&cli->usif);
 		}
 	} else {
 		argv->v0.route = NVIF_IOCTL_V0_ROUTE_HIDDEN;
 		argv->v0.token = 0;
 	}
 	argv->v0.owner = owner;
-	mutex_unlock(&cli->mutex);
+	if (shared)
+		up_read(&cli->usif);
+	else
+		mutex_unlock(&cli->mutex);
 
-	if (copy_to_user(user, argv, argc))
+	if (copy_to_user(user, argv, usif_args_reply(argv->v0.type, argc)))
 		ret = -EFAULT;
 done:
-	kfree(argv);
+	usif_args_put(cli, stack, argv);
 	return ret;
 }
 
@@ -389,6 +494,9 @@ usif_client_fini(struct nouveau_cli *cli)
 	list_for_each_entry_safe(object, otemp, &cli->objects, head) {
 		usif_object_dtor(object);
 	}
+
+	kfree(cli->usif_arena);
+	cli->usif_arena = NULL;
 }
 
 void
@@ -396,4 +504,5 @@ usif_client_init(struct nouveau_cli *cli)
 {
 	INIT_LIST_HEAD(&cli->objects);
 	INIT_LIST_HEAD(&cli->notifys);
+	init_rwsem(&cli->usif);
 }
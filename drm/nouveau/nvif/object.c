@@ -62,12 +62,19 @@ nvif_object_sclass_get(struct nvif_object *object, struct nvif_sclass **psclass)
 		struct nvif_ioctl_v0 ioctl;
 		struct nvif_ioctl_sclass_v0 sclass;
 	} *args = NULL;
-	int ret, cnt = 0, i;
+	u8 stack[128];
+	int ret, cnt, i;
 	u32 size;
 
+	/* most objects only have a handful of classes, so try the stack
+	 * first, and only allocate if that turns out to be too small
+	 */
+	cnt = (sizeof(stack) - sizeof(*args)) / sizeof(args->sclass.oclass[0]);
+	args = (void *)stack;
+
 	while (1) {
 		size = sizeof(*args) + cnt * sizeof(args->sclass.oclass[0]);
-		if (!(args = kmalloc(size, GFP_KERNEL)))
+		if (!args && !(args = kmalloc(size, GFP_KERNEL)))
 			return -ENOMEM;
 		args->ioctl.version = 0;
 		args->ioctl.type = NVIF_IOCTL_V0_SCLASS;
@@ -78,7 +85,9 @@ nvif_object_sclass_get(struct nvif_object *object, struct nvif_sclass **psclass)
 		if (ret == 0 && args->sclass.count <= cnt)
 			break;
 		cnt = args->sclass.count;
-		kfree(args);
+		if (args != (void *)stack)
+			kfree(args);
+		args = NULL;
 		if (ret != 0)
 			return ret;
 	}
@@ -95,7 +104,8 @@ nvif_object_sclass_get(struct nvif_object *object, struct nvif_sclass **psclass)
 		ret = -ENOMEM;
 	}
 
-	kfree(args);
+	if (args != (void *)stack)
+		kfree(args);
 	return ret;
 }
 
@@ -136,6 +146,120 @@ nvif_object_wr(struct nvif_object *object, int size, u64 addr, u32 data)
 	}
 }
 
+/* Each ioctl carries at most a page worth of entries, so a long register
+ * list doesn't need one huge allocation here and another in the driver.
+ *
+ * Returns the number of entries that were completed, which is the index
+ * of the one that failed if it's less than count, or a negative error code
+ * if not even the first entry could be completed.
+ */
+#define NVIF_OBJECT_RWV_MAX 256
+
+int
+nvif_object_rdv(struct nvif_object *object, int size, const u64 *addr,
+		u32 *data, int count)
+{
+	struct {
+		struct nvif_ioctl_v0 ioctl;
+		struct nvif_ioctl_rdv_v0 rdv;
+	} *args;
+	int ret, done, nr, i;
+
+	if (object->map.ptr) {
+		u8 __iomem *map = object->map.ptr;
+		for (i = 0; i < count; i++) {
+			void __iomem *ptr = map + addr[i];
+			switch (size) {
+			case 1: data[i] = ioread8(ptr); break;
+			case 2: data[i] = ioread16_native(ptr); break;
+			case 4: data[i] = ioread32_native(ptr); break;
+			default:
+				return i ? i : -EINVAL;
+			}
+		}
+		return count;
+	}
+
+	nr = min(count, NVIF_OBJECT_RWV_MAX);
+	args = kzalloc(sizeof(*args) + nr * sizeof(args->rdv.reg[0]),
+		       GFP_KERNEL);
+	if (!args)
+		return -ENOMEM;
+
+	for (ret = 0, done = 0; ret == 0 && done < count; done += nr) {
+		nr = min(count - done, NVIF_OBJECT_RWV_MAX);
+		memset(args, 0x00, sizeof(*args));
+		args->ioctl.type = NVIF_IOCTL_V0_RDV;
+		args->rdv.count = nr;
+		for (i = 0; i < nr; i++) {
+			args->rdv.reg[i].size = size;
+			args->rdv.reg[i].addr = addr[done + i];
+		}
+
+		ret = nvif_object_ioctl(object, args, sizeof(*args) +
+					nr * sizeof(args->rdv.reg[0]), NULL);
+		if (ret)
+			nr = args->rdv.count < nr ? args->rdv.count : 0;
+		for (i = 0; i < nr; i++)
+			data[done + i] = args->rdv.reg[i].data;
+	}
+
+	kfree(args);
+	return (ret && !done) ? ret : done;
+}
+
+int
+nvif_object_wrv(struct nvif_object *object, int size, const u64 *addr,
+		const u32 *data, int count)
+{
+	struct {
+		struct nvif_ioctl_v0 ioctl;
+		struct nvif_ioctl_wrv_v0 wrv;
+	} *args;
+	int ret, done, nr, i;
+
+	if (object->map.ptr) {
+		u8 __iomem *map = object->map.ptr;
+		for (i = 0; i < count; i++) {
+			void __iomem *ptr = map + addr[i];
+			switch (size) {
+			case 1: iowrite8(data[i], ptr); break;
+			case 2: iowrite16_native(data[i], ptr); break;
+			case 4: iowrite32_native(data[i], ptr); break;
+			default:
+				return i ? i : -EINVAL;
+			}
+		}
+		return count;
+	}
+
+	nr = min(count, NVIF_OBJECT_RWV_MAX);
+	args = kzalloc(sizeof(*args) + nr * sizeof(args->wrv.reg[0]),
+		       GFP_KERNEL);
+	if (!args)
+		return -ENOMEM;
+
+	for (ret = 0, done = 0; ret == 0 && done < count; done += nr) {
+		nr = min(count - done, NVIF_OBJECT_RWV_MAX);
+		memset(args, 0x00, sizeof(*args));
+		args->ioctl.type = NVIF_IOCTL_V0_WRV;
+		args->wrv.count = nr;
+		for (i = 0; i < nr; i++) {
+			args->wrv.reg[i].size = size;
+			args->wrv.reg[i].addr = addr[done + i];
+			args->wrv.reg[i].data = data[done + i];
+		}
+
+		ret = nvif_object_ioctl(object, args, sizeof(*args) +
+					nr * sizeof(args->wrv.reg[0]), NULL);
+		if (ret)
+			nr = args->wrv.count < nr ? args->wrv.count : 0;
+	}
+
+	kfree(args);
+	return (ret && !done) ? ret : done;
+}
+
 int
 nvif_object_mthd(struct nvif_object *object, u32 mthd, void *data, u32 size)
 {
@@ -23,6 +23,7 @@
  */
 #include <core/client.h>
 #include <core/device.h>
+#include <core/ioctl.h>
 #include <core/notify.h>
 #include <core/option.h>
 
@@ -164,12 +165,48 @@ nvkm_client_mthd_devlist(struct nvkm_object *object, void *data, u32 size)
 	return ret;
 }
 
+static int
+nvkm_client_mthd_ioctl_stats(struct nvkm_object *object, void *data, u32 size)
+{
+	struct nvkm_client *client = object->client;
+	union {
+		struct nv_client_ioctl_stats_v0 v0;
+	} *args = data;
+	bool enabled;
+	int ret = -ENOSYS;
+
+	nvif_ioctl(object, "client ioctl stats size %d\n", size);
+	if (!(ret = nvif_unpack(ret, &data, &size, args->v0, 0, 0, true))) {
+		nvif_ioctl(object, "client ioctl stats vers %d "
+				   "flags %02x count %d\n", args->v0.version,
+			   args->v0.flags, args->v0.count);
+		/* the stats are global, covering every client */
+		if (!client->super)
+			return -EACCES;
+		if (size == sizeof(args->v0.entry[0]) * args->v0.count) {
+			ret = nvkm_ioctl_stats(args->v0.flags, &enabled,
+					       args->v0.entry, args->v0.count);
+			if (ret >= 0) {
+				args->v0.enabled = enabled;
+				args->v0.count = ret;
+				ret = 0;
+			}
+		} else {
+			ret = -EINVAL;
+		}
+	}
+
+	return ret;
+}
+
 static int
 nvkm_client_mthd(struct nvkm_object *object, u32 mthd, void *data, u32 size)
 {
 	switch (mthd) {
 	case NV_CLIENT_DEVLIST:
 		return nvkm_client_mthd_devlist(object, data, size);
+	case NV_CLIENT_IOCTL_STATS:
+		return nvkm_client_mthd_ioctl_stats(object, data, size);
 	default:
 		break;
 	}
@@ -237,6 +274,9 @@ nvkm_client_insert(struct nvkm_client *client, struct nvkm_object *object)
 	return true;
 }
 
+/* the tree is only modified with client->lock held for write, so holding
+ * it for read is sufficient for lookups
+ */
 struct nvkm_object *
 nvkm_client_search(struct nvkm_client *client, u64 handle)
 {
@@ -294,11 +334,16 @@ nvkm_client_new(const char *name, u64 device, const char *cfg,
 {
 	struct nvkm_oclass oclass = {};
 	struct nvkm_client *client;
+	int i;
 
 	if (!(client = *pclient = kzalloc(sizeof(*client), GFP_KERNEL)))
 		return -ENOMEM;
 	oclass.client = client;
 
+	init_rwsem(&client->lock);
+	for (i = 0; i < ARRAY_SIZE(client->mthd); i++)
+		mutex_init(&client->mthd[i]);
+
 	nvkm_object_ctor(&nvkm_client_object_func, &oclass, &client->object);
 	snprintf(client->name, sizeof(client->name), "%s", name);
 	client->device = device;
@@ -48,25 +48,44 @@ nvkm_event_get(struct nvkm_event *event, u32 types, int index)
 	}
 }
 
+static inline void
+nvkm_event_notify(struct nvkm_event *event, struct nvkm_notify *notify,
+		  void *data, u32 size)
+{
+	if (event->func->send) {
+		event->func->send(data, size, notify);
+		return;
+	}
+	nvkm_notify_send(notify, data, size);
+}
+
 void
 nvkm_event_send(struct nvkm_event *event, u32 types, int index,
 		void *data, u32 size)
 {
 	struct nvkm_notify *notify;
+	struct list_head *list;
 	unsigned long flags;
+	u32 mask = types;
 
 	if (!event->refs || WARN_ON(index >= event->index_nr))
 		return;
 
 	spin_lock_irqsave(&event->list_lock, flags);
-	list_for_each_entry(notify, &event->list, head) {
-		if (notify->index == index && (notify->types & types)) {
-			if (event->func->send) {
-				event->func->send(data, size, notify);
-				continue;
-			}
-			nvkm_notify_send(notify, data, size);
-		}
+	while (mask) {
+		int type = __ffs(mask);
+		mask &= ~(1 << type);
+		if (WARN_ON(type >= event->types_nr))
+			break;
+		list = nvkm_event_list(event, 1 << type, index);
+		list_for_each_entry(notify, list, head)
+			nvkm_event_notify(event, notify, data, size);
+	}
+
+	list = nvkm_event_list(event, 0, index);
+	list_for_each_entry(notify, list, head) {
+		if (notify->types & types)
+			nvkm_event_notify(event, notify, data, size);
 	}
 	spin_unlock_irqrestore(&event->list_lock, flags);
 }
@@ -75,6 +94,8 @@ void
 nvkm_event_fini(struct nvkm_event *event)
 {
 	if (event->refs) {
+		kfree(event->list);
+		event->list = NULL;
 		kfree(event->refs);
 		event->refs = NULL;
 	}
@@ -84,16 +105,28 @@ int
 nvkm_event_init(const struct nvkm_event_func *func, int types_nr, int index_nr,
 		struct nvkm_event *event)
 {
+	int i;
+
+	event->list = kcalloc(index_nr * (types_nr + 1), sizeof(*event->list),
+			      GFP_KERNEL);
+	if (!event->list)
+		return -ENOMEM;
+
 	event->refs = kzalloc(sizeof(*event->refs) * index_nr * types_nr,
 			      GFP_KERNEL);
-	if (!event->refs)
+	if (!event->refs) {
+		kfree(event->list);
+		event->list = NULL;
 		return -ENOMEM;
+	}
+
+	for (i = 0; i < index_nr * (types_nr + 1); i++)
+		INIT_LIST_HEAD(&event->list[i]);
 
 	event->func = func;
 	event->types_nr = types_nr;
 	event->index_nr = index_nr;
 	spin_lock_init(&event->refs_lock);
 	spin_lock_init(&event->list_lock);
-	INIT_LIST_HEAD(&event->list);
 	return 0;
 }
@@ -41,6 +41,35 @@ nvkm_gpuobj_wr32_fast(struct nvkm_gpuobj *gpuobj, u32 offset, u32 data)
 	iowrite32_native(data, gpuobj->map + offset);
 }
 
+static void
+nvkm_gpuobj_rd_fast(struct nvkm_gpuobj *gpuobj, u32 offset, void *data,
+		    u32 size)
+{
+	memcpy_fromio(data, gpuobj->map + offset, size);
+}
+
+static void
+nvkm_gpuobj_wr_fast(struct nvkm_gpuobj *gpuobj, u32 offset, const void *data,
+		    u32 size)
+{
+	memcpy_toio(gpuobj->map + offset, data, size);
+}
+
+static void
+nvkm_gpuobj_fill_fast(struct nvkm_gpuobj *gpuobj, u32 offset, u32 data,
+		      u32 size)
+{
+	u32 i;
+
+	if (!data) {
+		memset_io(gpuobj->map + offset, 0x00, size);
+		return;
+	}
+
+	for (i = 0; i < size; i += 4)
+		iowrite32_native(data, gpuobj->map + offset + i);
+}
+
 /* accessor functions for gpuobjs allocated directly from instmem */
 static u32
 nvkm_gpuobj_heap_rd32(struct nvkm_gpuobj *gpuobj, u32 offset)
@@ -54,6 +83,27 @@ nvkm_gpuobj_heap_wr32(struct nvkm_gpuobj *gpuobj, u32 offset, u32 data)
 	nvkm_wo32(gpuobj->memory, offset, data);
 }
 
+static void
+nvkm_gpuobj_heap_rd(struct nvkm_gpuobj *gpuobj, u32 offset, void *data,
+		    u32 size)
+{
+	nvkm_ro(gpuobj->memory, offset, data, size);
+}
+
+static void
+nvkm_gpuobj_heap_wr(struct nvkm_gpuobj *gpuobj, u32 offset, const void *data,
+		    u32 size)
+{
+	nvkm_wo(gpuobj->memory, offset, data, size);
+}
+
+static void
+nvkm_gpuobj_heap_fill(struct nvkm_gpuobj *gpuobj, u32 offset, u32 data,
+		      u32 size)
+{
+	nvkm_fo32(gpuobj->memory, offset, data, size);
+}
+
 static const struct nvkm_gpuobj_func nvkm_gpuobj_heap;
 static void
 nvkm_gpuobj_heap_release(struct nvkm_gpuobj *gpuobj)
@@ -67,6 +117,9 @@ nvkm_gpuobj_heap_fast = {
 	.release = nvkm_gpuobj_heap_release,
 	.rd32 = nvkm_gpuobj_rd32_fast,
 	.wr32 = nvkm_gpuobj_wr32_fast,
+	.rd = nvkm_gpuobj_rd_fast,
+	.wr = nvkm_gpuobj_wr_fast,
+	.fill = nvkm_gpuobj_fill_fast,
 };
 
 static const struct nvkm_gpuobj_func
@@ -74,6 +127,9 @@ nvkm_gpuobj_heap_slow = {
 	.release = nvkm_gpuobj_heap_release,
 	.rd32 = nvkm_gpuobj_heap_rd32,
 	.wr32 = nvkm_gpuobj_heap_wr32,
+	.rd = nvkm_gpuobj_heap_rd,
+	.wr = nvkm_gpuobj_heap_wr,
+	.fill = nvkm_gpuobj_heap_fill,
 };
 
 static void *
@@ -105,6 +161,25 @@ nvkm_gpuobj_wr32(struct nvkm_gpuobj *gpuobj, u32 offset, u32 data)
 	nvkm_wo32(gpuobj->parent, gpuobj->node->offset + offset, data);
 }
 
+static void
+nvkm_gpuobj_rd(struct nvkm_gpuobj *gpuobj, u32 offset, void *data, u32 size)
+{
+	nvkm_ro(gpuobj->parent, gpuobj->node->offset + offset, data, size);
+}
+
+static void
+nvkm_gpuobj_wr(struct nvkm_gpuobj *gpuobj, u32 offset, const void *data,
+	       u32 size)
+{
+	nvkm_wo(gpuobj->parent, gpuobj->node->offset + offset, data, size);
+}
+
+static void
+nvkm_gpuobj_fill(struct nvkm_gpuobj *gpuobj, u32 offset, u32 data, u32 size)
+{
+	nvkm_fo32(gpuobj->parent, gpuobj->node->offset + offset, data, size);
+}
+
 static const struct nvkm_gpuobj_func nvkm_gpuobj_func;
 static void
 nvkm_gpuobj_release(struct nvkm_gpuobj *gpuobj)
@@ -118,6 +193,9 @@ nvkm_gpuobj_fast = {
 	.release = nvkm_gpuobj_release,
 	.rd32 = nvkm_gpuobj_rd32_fast,
 	.wr32 = nvkm_gpuobj_wr32_fast,
+	.rd = nvkm_gpuobj_rd_fast,
+	.wr = nvkm_gpuobj_wr_fast,
+	.fill = nvkm_gpuobj_fill_fast,
 };
 
 static const struct nvkm_gpuobj_func
@@ -125,6 +203,9 @@ nvkm_gpuobj_slow = {
 	.release = nvkm_gpuobj_release,
 	.rd32 = nvkm_gpuobj_rd32,
 	.wr32 = nvkm_gpuobj_wr32,
+	.rd = nvkm_gpuobj_rd,
+	.wr = nvkm_gpuobj_wr,
+	.fill = nvkm_gpuobj_fill,
 };
 
 static void *
@@ -149,7 +230,6 @@ static int
 nvkm_gpuobj_ctor(struct nvkm_device *device, u32 size, int align, bool zero,
 		 struct nvkm_gpuobj *parent, struct nvkm_gpuobj *gpuobj)
 {
-	u32 offset;
 	int ret;
 
 	if (parent) {
@@ -170,8 +250,7 @@ nvkm_gpuobj_ctor(struct nvkm_device *device, u32 size, int align, bool zero,
 
 		if (zero) {
 			nvkm_kmap(gpuobj);
-			for (offset = 0; offset < gpuobj->size; offset += 4)
-				nvkm_wo32(gpuobj, offset, 0x00000000);
+			nvkm_fo32(gpuobj, 0, 0x00000000, gpuobj->size);
 			nvkm_done(gpuobj);
 		}
 	} else {
@@ -255,21 +334,15 @@ nvkm_gpuobj_wrap(struct nvkm_memory *memory, struct nvkm_gpuobj **pgpuobj)
 }
 
 void
-nvkm_gpuobj_memcpy_to(struct nvkm_gpuobj *dst, u32 dstoffset, void *src,
-		      u32 length)
+nvkm_gpuobj_memcpy_to(struct nvkm_gpuobj *dst, u32 dstoffset,
+		      const void *src, u32 length)
 {
-	int i;
-
-	for (i = 0; i < length; i += 4)
-		nvkm_wo32(dst, dstoffset + i, *(u32 *)(src + i));
+	nvkm_wo(dst, dstoffset, src, length);
 }
 
 void
 nvkm_gpuobj_memcpy_from(void *dst, struct nvkm_gpuobj *src, u32 srcoffset,
 			u32 length)
 {
-	int i;
-
-	for (i = 0; i < length; i += 4)
-		((u32 *)src)[i / 4] = nvkm_ro32(src, srcoffset + i);
+	nvkm_ro(src, srcoffset, dst, length);
 }
@@ -27,6 +27,7 @@
 
 #include <nvif/unpack.h>
 #include <nvif/ioctl.h>
+#include <nvif/if0000.h>
 
 static int
 nvkm_ioctl_nop(struct nvkm_object *object, void *data, u32 size)
@@ -61,8 +62,7 @@ nvkm_ioctl_sclass(struct nvkm_object *object, void *data, u32 size)
 		if (size != args->v0.count * sizeof(args->v0.oclass[0]))
 			return -EINVAL;
 
-		while (object->func->sclass &&
-		       object->func->sclass(object, i, &oclass) >= 0) {
+		while (nvkm_object_sclass(object, i, &oclass) == 0) {
 			if (i < args->v0.count) {
 				args->v0.oclass[i].oclass = oclass.base.oclass;
 				args->v0.oclass[i].minver = oclass.base.minver;
@@ -86,7 +86,7 @@ nvkm_ioctl_new(struct nvkm_object *parent, void *data, u32 size)
 	struct nvkm_client *client = parent->client;
 	struct nvkm_object *object = NULL;
 	struct nvkm_oclass oclass;
-	int ret = -ENOSYS, i = 0;
+	int ret = -ENOSYS;
 
 	nvif_ioctl(parent, "new size %d\n", size);
 	if (!(ret = nvif_unpack(ret, &data, &size, args->v0, 0, 0, true))) {
@@ -102,16 +102,11 @@ nvkm_ioctl_new(struct nvkm_object *parent, void *data, u32 size)
 		return -EINVAL;
 	}
 
-	do {
-		memset(&oclass, 0x00, sizeof(oclass));
-		oclass.client = client;
-		oclass.handle = args->v0.handle;
-		oclass.object = args->v0.object;
-		oclass.parent = parent;
-		ret = parent->func->sclass(parent, i++, &oclass);
-		if (ret)
-			return ret;
-	} while (oclass.base.oclass != args->v0.oclass);
+	ret = nvkm_object_sclass_find(parent, args->v0.oclass, &oclass);
+	if (ret)
+		return ret;
+	oclass.handle = args->v0.handle;
+	oclass.object = args->v0.object;
 
 	if (oclass.engine) {
 		oclass.engine = nvkm_engine_ref(oclass.engine);
@@ -159,6 +154,20 @@ nvkm_ioctl_del(struct nvkm_object *object, void *data, u32 size)
 	return ret;
 }
 
+/* Methods run concurrently with other ioctls on the client, but may touch
+ * state shared by all objects of an engine, so are serialised per-engine,
+ * or per-object for objects that don't belong to one.
+ */
+static struct mutex *
+nvkm_ioctl_mthd_lock(struct nvkm_object *object)
+{
+	struct nvkm_client *client = object->client;
+	unsigned long key = object->engine ? (unsigned long)object->engine :
+					     (unsigned long)object;
+	u32 hash = (u32)(key >> 4) * 0x9e3779b9;
+	return &client->mthd[hash >> 28];
+}
+
 static int
 nvkm_ioctl_mthd(struct nvkm_object *object, void *data, u32 size)
 {
@@ -169,9 +178,12 @@ nvkm_ioctl_mthd(struct nvkm_object *object, void *data, u32 size)
 
 	nvif_ioctl(object, "mthd size %d\n", size);
 	if (!(ret = nvif_unpack(ret, &data, &size, args->v0, 0, 0, true))) {
+		struct mutex *mutex = nvkm_ioctl_mthd_lock(object);
 		nvif_ioctl(object, "mthd vers %d mthd %02x\n",
 			   args->v0.version, args->v0.method);
+		mutex_lock(mutex);
 		ret = nvkm_object_mthd(object, args->v0.method, data, size);
+		mutex_unlock(mutex);
 	}
 
 	return ret;
@@ -179,39 +191,64 @@ nvkm_ioctl_mthd(struct nvkm_object *object, void *data, u32 size)
 
 
 static int
-nvkm_ioctl_rd(struct nvkm_object *object, void *data, u32 size)
+nvkm_ioctl_rd_one(struct nvkm_object *object, u8 size, u64 addr, u32 *data)
 {
-	union {
-		struct nvif_ioctl_rd_v0 v0;
-	} *args = data;
 	union {
 		u8  b08;
 		u16 b16;
 		u32 b32;
 	} v;
+	int ret;
+
+	switch (size) {
+	case 1:
+		ret = nvkm_object_rd08(object, addr, &v.b08);
+		*data = v.b08;
+		break;
+	case 2:
+		ret = nvkm_object_rd16(object, addr, &v.b16);
+		*data = v.b16;
+		break;
+	case 4:
+		ret = nvkm_object_rd32(object, addr, &v.b32);
+		*data = v.b32;
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	return ret;
+}
+
+static int
+nvkm_ioctl_wr_one(struct nvkm_object *object, u8 size, u64 addr, u32 data)
+{
+	switch (size) {
+	case 1: return nvkm_object_wr08(object, addr, data);
+	case 2: return nvkm_object_wr16(object, addr, data);
+	case 4: return nvkm_object_wr32(object, addr, data);
+	default:
+		break;
+	}
+
+	return -EINVAL;
+}
+
+static int
+nvkm_ioctl_rd(struct nvkm_object *object, void *data, u32 size)
+{
+	union {
+		struct nvif_ioctl_rd_v0 v0;
+	} *args = data;
 	int ret = -ENOSYS;
 
 	nvif_ioctl(object, "rd size %d\n", size);
 	if (!(ret = nvif_unpack(ret, &data, &size, args->v0, 0, 0, false))) {
 		nvif_ioctl(object, "rd vers %d size %d addr %016llx\n",
 			   args->v0.version, args->v0.size, args->v0.addr);
-		switch (args->v0.size) {
-		case 1:
-			ret = nvkm_object_rd08(object, args->v0.addr, &v.b08);
-			args->v0.data = v.b08;
-			break;
-		case 2:
-			ret = nvkm_object_rd16(object, args->v0.addr, &v.b16);
-			args->v0.data = v.b16;
-			break;
-		case 4:
-			ret = nvkm_object_rd32(object, args->v0.addr, &v.b32);
-			args->v0.data = v.b32;
-			break;
-		default:
-			ret = -EINVAL;
-			break;
-		}
+		ret = nvkm_ioctl_rd_one(object, args->v0.size, args->v0.addr,
+					&args->v0.data);
 	}
 
 	return ret;
@@ -234,15 +271,71 @@ nvkm_ioctl_wr(struct nvkm_object *object, void *data, u32 size)
 	} else
 		return ret;
 
-	switch (args->v0.size) {
-	case 1: return nvkm_object_wr08(object, args->v0.addr, args->v0.data);
-	case 2: return nvkm_object_wr16(object, args->v0.addr, args->v0.data);
-	case 4: return nvkm_object_wr32(object, args->v0.addr, args->v0.data);
-	default:
-		break;
+	return nvkm_ioctl_wr_one(object, args->v0.size, args->v0.addr,
+				 args->v0.data);
+}
+
+/* Vectored variants of rd/wr, each entry carries its own access size.
+ * Entries are processed in order, stopping at the first that fails, so
+ * a caller can batch up a whole register list in a single ioctl.  On
+ * failure, count is replaced by the index of the entry that failed.
+ */
+static int
+nvkm_ioctl_rdv(struct nvkm_object *object, void *data, u32 size)
+{
+	union {
+		struct nvif_ioctl_rdv_v0 v0;
+	} *args = data;
+	int ret = -ENOSYS, i;
+
+	nvif_ioctl(object, "rdv size %d\n", size);
+	if (!(ret = nvif_unpack(ret, &data, &size, args->v0, 0, 0, true))) {
+		nvif_ioctl(object, "rdv vers %d count %d\n",
+			   args->v0.version, args->v0.count);
+		if (size != args->v0.count * sizeof(args->v0.reg[0]))
+			return -EINVAL;
+
+		for (i = 0; i < args->v0.count; i++) {
+			struct nvif_ioctl_rdv_reg_v0 *reg = &args->v0.reg[i];
+			ret = nvkm_ioctl_rd_one(object, reg->size, reg->addr,
+						&reg->data);
+			if (ret) {
+				args->v0.count = i;
+				break;
+			}
+		}
 	}
 
-	return -EINVAL;
+	return ret;
+}
+
+static int
+nvkm_ioctl_wrv(struct nvkm_object *object, void *data, u32 size)
+{
+	union {
+		struct nvif_ioctl_wrv_v0 v0;
+	} *args = data;
+	int ret = -ENOSYS, i;
+
+	nvif_ioctl(object, "wrv size %d\n", size);
+	if (!(ret = nvif_unpack(ret, &data, &size, args->v0, 0, 0, true))) {
+		nvif_ioctl(object, "wrv vers %d count %d\n",
+			   args->v0.version, args->v0.count);
+		if (size != args->v0.count * sizeof(args->v0.reg[0]))
+			return -EINVAL;
+
+		for (i = 0; i < args->v0.count; i++) {
+			struct nvif_ioctl_wrv_reg_v0 *reg = &args->v0.reg[i];
+			ret = nvkm_ioctl_wr_one(object, reg->size, reg->addr,
+						reg->data);
+			if (ret) {
+				args->v0.count = i;
+				break;
+			}
+		}
+	}
+
+	return ret;
 }
 
 static int
@@ -380,8 +473,193 @@ nvkm_ioctl_v0[] = {
 	{ 0x00, nvkm_ioctl_ntfy_del },
 	{ 0x00, nvkm_ioctl_ntfy_get },
 	{ 0x00, nvkm_ioctl_ntfy_put },
+	{ 0x00, nvkm_ioctl_rdv },
+	{ 0x00, nvkm_ioctl_wrv },
+};
+
+/* Per-ioctl statistics, shared by all clients.  The per-cpu counters are
+ * only allocated the first time collection is enabled, and stay around
+ * until module unload so that nothing on the ioctl path needs to take a
+ * reference on them.  Methods are additionally broken down by (oclass,
+ * method) pair, with the pairs that don't fit in the table lumped into
+ * a single overflow slot.
+ */
+#define NVKM_IOCTL_STATS_MTHD 64
+
+struct nvkm_ioctl_stat {
+	u64 count;
+	u64 time;
+	u32 hist[NV_CLIENT_IOCTL_STATS_V0_HIST];
 };
 
+struct nvkm_ioctl_stats {
+	struct nvkm_ioctl_stat type[ARRAY_SIZE(nvkm_ioctl_v0)];
+	struct nvkm_ioctl_stat mthd[NVKM_IOCTL_STATS_MTHD + 1];
+};
+
+static struct nvkm_ioctl_stats __percpu *nvkm_ioctl_stats_pcpu;
+static u64 nvkm_ioctl_stats_key[NVKM_IOCTL_STATS_MTHD];
+static DEFINE_SPINLOCK(nvkm_ioctl_stats_lock);
+static DEFINE_MUTEX(nvkm_ioctl_stats_mutex);
+static bool nvkm_ioctl_stats_on;
+
+static int
+nvkm_ioctl_stats_slot(s32 oclass, u8 method)
+{
+	const u64 key = (u64)(u32)oclass << 32 | BIT(8) | method;
+	u32 slot = (key * 0x9e3779b97f4a7c15ULL) >> 58;
+	u64 have;
+	int i;
+
+	for (i = 0; i < NVKM_IOCTL_STATS_MTHD; i++) {
+		if ((have = READ_ONCE(nvkm_ioctl_stats_key[slot])) == key)
+			return slot;
+
+		if (!have) {
+			spin_lock(&nvkm_ioctl_stats_lock);
+			if (!(have = nvkm_ioctl_stats_key[slot])) {
+				WRITE_ONCE(nvkm_ioctl_stats_key[slot], key);
+				have = key;
+			}
+			spin_unlock(&nvkm_ioctl_stats_lock);
+			if (have == key)
+				return slot;
+		}
+
+		slot = (slot + 1) & (NVKM_IOCTL_STATS_MTHD - 1);
+	}
+
+	return NVKM_IOCTL_STATS_MTHD;
+}
+
+static void
+nvkm_ioctl_stats_add(struct nvkm_ioctl_stat __percpu *stat, u64 time)
+{
+	int bucket = min_t(int, fls64(time), ARRAY_SIZE(stat->hist) - 1);
+	this_cpu_inc(stat->count);
+	this_cpu_add(stat->time, time);
+	this_cpu_inc(stat->hist[bucket]);
+}
+
+static int
+nvkm_ioctl_timed(struct nvkm_object *object, u32 type, void *data, u32 size)
+{
+	struct nvkm_ioctl_stats __percpu *stats;
+	union {
+		struct nvif_ioctl_mthd_v0 v0;
+	} *args = data;
+	s32 oclass = object->oclass;
+	s64 time;
+	int ret;
+
+	time = ktime_to_ns(ktime_get());
+	ret = nvkm_ioctl_v0[type].func(object, data, size);
+	time = ktime_to_ns(ktime_get()) - time;
+
+	if ((stats = smp_load_acquire(&nvkm_ioctl_stats_pcpu))) {
+		nvkm_ioctl_stats_add(&stats->type[type], time);
+		if (type == NVIF_IOCTL_V0_MTHD && size >= sizeof(args->v0)) {
+			int i = nvkm_ioctl_stats_slot(oclass, args->v0.method);
+			nvkm_ioctl_stats_add(&stats->mthd[i], time);
+		}
+	}
+
+	return ret;
+}
+
+static bool
+nvkm_ioctl_stats_sum(struct nvkm_ioctl_stat __percpu *stat,
+		     struct nv_client_ioctl_stats_entry_v0 *entry)
+{
+	int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		struct nvkm_ioctl_stat *local = per_cpu_ptr(stat, cpu);
+		entry->count += local->count;
+		entry->time += local->time;
+		for (i = 0; i < ARRAY_SIZE(local->hist); i++)
+			entry->hist[i] += local->hist[i];
+	}
+
+	return entry->count != 0;
+}
+
+int
+nvkm_ioctl_stats(u8 flags, bool *enabled,
+		 struct nv_client_ioctl_stats_entry_v0 *entry, u32 count)
+{
+	struct nvkm_ioctl_stats __percpu *stats;
+	struct nv_client_ioctl_stats_entry_v0 sum;
+	u32 ret = 0;
+	int cpu, i;
+
+	mutex_lock(&nvkm_ioctl_stats_mutex);
+	stats = nvkm_ioctl_stats_pcpu;
+
+	if ((flags & NV_CLIENT_IOCTL_STATS_V0_ENABLE) && !stats) {
+		if (!(stats = alloc_percpu(struct nvkm_ioctl_stats))) {
+			mutex_unlock(&nvkm_ioctl_stats_mutex);
+			return -ENOMEM;
+		}
+		smp_store_release(&nvkm_ioctl_stats_pcpu, stats);
+	}
+
+	if (flags & NV_CLIENT_IOCTL_STATS_V0_DISABLE)
+		WRITE_ONCE(nvkm_ioctl_stats_on, false);
+
+	if ((flags & NV_CLIENT_IOCTL_STATS_V0_RESET) && stats) {
+		for_each_possible_cpu(cpu)
+			memset(per_cpu_ptr(stats, cpu), 0x00, sizeof(*stats));
+	}
+
+	if (flags & NV_CLIENT_IOCTL_STATS_V0_ENABLE)
+		WRITE_ONCE(nvkm_ioctl_stats_on, true);
+	*enabled = READ_ONCE(nvkm_ioctl_stats_on);
+
+	for (i = 0; stats && i < ARRAY_SIZE(stats->type); i++) {
+		memset(&sum, 0x00, sizeof(sum));
+		sum.type = i;
+		if (nvkm_ioctl_stats_sum(&stats->type[i], &sum)) {
+			if (ret < count)
+				entry[ret] = sum;
+			ret++;
+		}
+	}
+
+	for (i = 0; stats && i < ARRAY_SIZE(stats->mthd); i++) {
+		u64 key = 0;
+
+		if (i < NVKM_IOCTL_STATS_MTHD) {
+			if (!(key = READ_ONCE(nvkm_ioctl_stats_key[i])))
+				continue;
+		}
+
+		memset(&sum, 0x00, sizeof(sum));
+		sum.type = NVIF_IOCTL_V0_MTHD;
+		sum.flags = NV_CLIENT_IOCTL_STATS_V0_ENTRY_MTHD;
+		if (!key)
+			sum.flags |= NV_CLIENT_IOCTL_STATS_V0_ENTRY_OTHER;
+		sum.oclass = key >> 32;
+		sum.method = key & 0xff;
+		if (nvkm_ioctl_stats_sum(&stats->mthd[i], &sum)) {
+			if (ret < count)
+				entry[ret] = sum;
+			ret++;
+		}
+	}
+
+	mutex_unlock(&nvkm_ioctl_stats_mutex);
+	return ret;
+}
+
+void
+nvkm_ioctl_stats_fini(void)
+{
+	WRITE_ONCE(nvkm_ioctl_stats_on, false);
+	free_percpu(nvkm_ioctl_stats_pcpu);
+	nvkm_ioctl_stats_pcpu = NULL;
+}
+
 static int
 nvkm_ioctl_path(struct nvkm_client *client, u64 handle, u32 type,
 		void *data, u32 size, u8 owner, u8 *route, u64 *token)
@@ -406,13 +684,52 @@ nvkm_ioctl_path(struct nvkm_client *client, u64 handle, u32 type,
 	*token = object->token;
 
 	if (ret = -EINVAL, type < ARRAY_SIZE(nvkm_ioctl_v0)) {
-		if (nvkm_ioctl_v0[type].version == 0)
+		if (nvkm_ioctl_v0[type].version == 0) {
+			if (unlikely(READ_ONCE(nvkm_ioctl_stats_on)))
+				return nvkm_ioctl_timed(object, type,
+							data, size);
 			ret = nvkm_ioctl_v0[type].func(object, data, size);
+		}
 	}
 
 	return ret;
 }
 
+/* ioctls that neither modify the object tree nor client state */
+static bool
+nvkm_ioctl_shared(u8 type)
+{
+	switch (type) {
+	case NVIF_IOCTL_V0_NOP:
+	case NVIF_IOCTL_V0_SCLASS:
+	case NVIF_IOCTL_V0_MTHD:
+	case NVIF_IOCTL_V0_RD:
+	case NVIF_IOCTL_V0_WR:
+	case NVIF_IOCTL_V0_RDV:
+	case NVIF_IOCTL_V0_WRV:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* ioctls that nvif_notify_get()/put() issue from atomic context (fence
+ * signalling, vblank enable/disable), these can't sleep on client->lock
+ * and run unlocked, as they always have, relying on the caller to not
+ * race them against destruction of the notifier
+ */
+static bool
+nvkm_ioctl_atomic(u8 type)
+{
+	switch (type) {
+	case NVIF_IOCTL_V0_NTFY_GET:
+	case NVIF_IOCTL_V0_NTFY_PUT:
+		return true;
+	default:
+		return false;
+	}
+}
+
 int
 nvkm_ioctl(struct nvkm_client *client, bool supervisor,
 	   void *data, u32 size, void **hack)
@@ -423,25 +740,49 @@ nvkm_ioctl(struct nvkm_client *client, bool supervisor,
 	} *args = data;
 	int ret = -ENOSYS;
 
-	client->super = supervisor;
+	if (hack)
+		*hack = NULL;
+
 	nvif_ioctl(object, "size %d\n", size);
+	if ((ret = nvif_unpack(ret, &data, &size, args->v0, 0, 0, true))) {
+		nvif_ioctl(object, "return %d\n", ret);
+		return ret;
+	}
 
-	if (!(ret = nvif_unpack(ret, &data, &size, args->v0, 0, 0, true))) {
-		nvif_ioctl(object,
-			   "vers %d type %02x object %016llx owner %02x\n",
-			   args->v0.version, args->v0.type, args->v0.object,
-			   args->v0.owner);
+	nvif_ioctl(object, "vers %d type %02x object %016llx owner %02x\n",
+		   args->v0.version, args->v0.type, args->v0.object,
+		   args->v0.owner);
+
+	if (nvkm_ioctl_atomic(args->v0.type)) {
 		ret = nvkm_ioctl_path(client, args->v0.object, args->v0.type,
 				      data, size, args->v0.owner,
 				      &args->v0.route, &args->v0.token);
+		nvif_ioctl(object, "return %d\n", ret);
+		return ret;
 	}
 
-	nvif_ioctl(object, "return %d\n", ret);
-	if (hack) {
-		*hack = client->data;
+	/* client->super is only ever changed with the lock held for write,
+	 * shared ioctls can only go ahead if it already matches
+	 */
+	down_read(&client->lock);
+	if (nvkm_ioctl_shared(args->v0.type) && client->super == supervisor) {
+		ret = nvkm_ioctl_path(client, args->v0.object, args->v0.type,
+				      data, size, args->v0.owner,
+				      &args->v0.route, &args->v0.token);
+		up_read(&client->lock);
+	} else {
+		up_read(&client->lock);
+		down_write(&client->lock);
+		client->super = supervisor;
+		ret = nvkm_ioctl_path(client, args->v0.object, args->v0.type,
+				      data, size, args->v0.owner,
+				      &args->v0.route, &args->v0.token);
+		if (hack)
+			*hack = client->data;
 		client->data = NULL;
+		up_write(&client->lock);
 	}
 
-	client->super = false;
+	nvif_ioctl(object, "return %d\n", ret);
 	return ret;
 }
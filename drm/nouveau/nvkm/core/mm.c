@@ -26,10 +26,189 @@
 #define node(root, dir) ((root)->nl_entry.dir == &mm->nodes) ? NULL :          \
 	list_entry((root)->nl_entry.dir, struct nvkm_mm_node, nl_entry)
 
+/* nodes come from a cache shared by every allocator, which exists for as
+ * long as at least one nvkm_mm is initialised
+ */
+static DEFINE_MUTEX(nvkm_mm_mutex);
+static struct kmem_cache *nvkm_mm_cache;
+static int nvkm_mm_users;
+
+static int
+nvkm_mm_cache_get(void)
+{
+	int ret = 0;
+	mutex_lock(&nvkm_mm_mutex);
+	if (!nvkm_mm_users++) {
+		nvkm_mm_cache = KMEM_CACHE(nvkm_mm_node, 0);
+		if (!nvkm_mm_cache) {
+			nvkm_mm_users--;
+			ret = -ENOMEM;
+		}
+	}
+	mutex_unlock(&nvkm_mm_mutex);
+	return ret;
+}
+
+static void
+nvkm_mm_cache_put(void)
+{
+	mutex_lock(&nvkm_mm_mutex);
+	if (!--nvkm_mm_users) {
+		kmem_cache_destroy(nvkm_mm_cache);
+		nvkm_mm_cache = NULL;
+	}
+	mutex_unlock(&nvkm_mm_mutex);
+}
+
+/* free regions are kept in an rbtree ordered by offset, with each node
+ * tracking the largest free region in its subtree so that first/last-fit
+ * searches can skip subtrees that can't possibly satisfy a request
+ */
+#define fl_node(rb) rb_entry((rb), struct nvkm_mm_node, fl_node)
+
+static inline u32
+nvkm_mm_fl_max(struct nvkm_mm_node *node)
+{
+	struct rb_node *l = node->fl_node.rb_left;
+	struct rb_node *r = node->fl_node.rb_right;
+	u32 size = node->length;
+	if (l)
+		size = max(size, fl_node(l)->fl_max);
+	if (r)
+		size = max(size, fl_node(r)->fl_max);
+	return size;
+}
+
+RB_DECLARE_CALLBACKS(static, nvkm_mm_fl, struct nvkm_mm_node, fl_node,
+		     u32, fl_max, nvkm_mm_fl_max)
+
+static void
+nvkm_mm_fl_insert(struct nvkm_mm *mm, struct nvkm_mm_node *node)
+{
+	struct rb_node **ptr = &mm->free.rb_node;
+	struct rb_node *parent = NULL;
+
+	while (*ptr) {
+		struct nvkm_mm_node *this = fl_node(*ptr);
+		parent = *ptr;
+		if (this->fl_max < node->length)
+			this->fl_max = node->length;
+		if (node->offset < this->offset)
+			ptr = &parent->rb_left;
+		else
+			ptr = &parent->rb_right;
+	}
+
+	node->fl_max = node->length;
+	rb_link_node(&node->fl_node, parent, ptr);
+	rb_insert_augmented(&node->fl_node, &mm->free, &nvkm_mm_fl);
+}
+
+static inline void
+nvkm_mm_fl_remove(struct nvkm_mm *mm, struct nvkm_mm_node *node)
+{
+	rb_erase_augmented(&node->fl_node, &mm->free, &nvkm_mm_fl);
+}
+
+static inline void
+nvkm_mm_fl_update(struct nvkm_mm_node *node)
+{
+	nvkm_mm_fl_propagate(&node->fl_node, NULL);
+}
+
+/* lowest/highest free region within a subtree of at least 'size' units */
+static struct nvkm_mm_node *
+nvkm_mm_fl_head(struct rb_node *rb, u32 size)
+{
+	while (rb) {
+		struct nvkm_mm_node *this = fl_node(rb);
+		struct rb_node *left = rb->rb_left;
+
+		if (this->fl_max < size)
+			break;
+
+		if (left && fl_node(left)->fl_max >= size)
+			rb = left;
+		else
+		if (this->length >= size)
+			return this;
+		else
+			rb = rb->rb_right;
+	}
+	return NULL;
+}
+
+static struct nvkm_mm_node *
+nvkm_mm_fl_tail(struct rb_node *rb, u32 size)
+{
+	while (rb) {
+		struct nvkm_mm_node *this = fl_node(rb);
+		struct rb_node *right = rb->rb_right;
+
+		if (this->fl_max < size)
+			break;
+
+		if (right && fl_node(right)->fl_max >= size)
+			rb = right;
+		else
+		if (this->length >= size)
+			return this;
+		else
+			rb = rb->rb_left;
+	}
+	return NULL;
+}
+
+/* next/prev free region (in offset order) of at least 'size' units */
+static struct nvkm_mm_node *
+nvkm_mm_fl_next(struct nvkm_mm_node *this, u32 size)
+{
+	struct rb_node *rb = &this->fl_node, *parent;
+
+	if ((this = nvkm_mm_fl_head(rb->rb_right, size)))
+		return this;
+
+	while ((parent = rb_parent(rb))) {
+		if (rb == parent->rb_left) {
+			this = fl_node(parent);
+			if (this->length >= size)
+				return this;
+			if ((this = nvkm_mm_fl_head(parent->rb_right, size)))
+				return this;
+		}
+		rb = parent;
+	}
+
+	return NULL;
+}
+
+static struct nvkm_mm_node *
+nvkm_mm_fl_prev(struct nvkm_mm_node *this, u32 size)
+{
+	struct rb_node *rb = &this->fl_node, *parent;
+
+	if ((this = nvkm_mm_fl_tail(rb->rb_left, size)))
+		return this;
+
+	while ((parent = rb_parent(rb))) {
+		if (rb == parent->rb_right) {
+			this = fl_node(parent);
+			if (this->length >= size)
+				return this;
+			if ((this = nvkm_mm_fl_tail(parent->rb_left, size)))
+				return this;
+		}
+		rb = parent;
+	}
+
+	return NULL;
+}
+
 void
 nvkm_mm_dump(struct nvkm_mm *mm, const char *header)
 {
 	struct nvkm_mm_node *node;
+	struct rb_node *rb;
 
 	printk(KERN_ERR "nvkm: %s\n", header);
 	printk(KERN_ERR "nvkm: node list:\n");
@@ -38,7 +217,8 @@ nvkm_mm_dump(struct nvkm_mm *mm, const char *header)
 		       node->offset, node->length, node->type);
 	}
 	printk(KERN_ERR "nvkm: free list:\n");
-	list_for_each_entry(node, &mm->free, fl_entry) {
+	for (rb = rb_first(&mm->free); rb; rb = rb_next(rb)) {
+		node = fl_node(rb);
 		printk(KERN_ERR "nvkm: \t%08x %08x %d\n",
 		       node->offset, node->length, node->type);
 	}
@@ -55,27 +235,24 @@ nvkm_mm_free(struct nvkm_mm *mm, struct nvkm_mm_node **pthis)
 
 		if (prev && prev->type == NVKM_MM_TYPE_NONE) {
 			prev->length += this->length;
+			nvkm_mm_fl_update(prev);
 			list_del(&this->nl_entry);
-			kfree(this); this = prev;
+			kmem_cache_free(nvkm_mm_cache, this); this = prev;
 		}
 
 		if (next && next->type == NVKM_MM_TYPE_NONE) {
+			if (this->type == NVKM_MM_TYPE_NONE)
+				nvkm_mm_fl_remove(mm, this);
 			next->offset  = this->offset;
 			next->length += this->length;
-			if (this->type == NVKM_MM_TYPE_NONE)
-				list_del(&this->fl_entry);
+			nvkm_mm_fl_update(next);
 			list_del(&this->nl_entry);
-			kfree(this); this = NULL;
+			kmem_cache_free(nvkm_mm_cache, this); this = NULL;
 		}
 
 		if (this && this->type != NVKM_MM_TYPE_NONE) {
-			list_for_each_entry(prev, &mm->free, fl_entry) {
-				if (this->offset < prev->offset)
-					break;
-			}
-
-			list_add_tail(&this->fl_entry, &prev->fl_entry);
 			this->type = NVKM_MM_TYPE_NONE;
+			nvkm_mm_fl_insert(mm, this);
 		}
 	}
 
@@ -90,7 +267,7 @@ region_head(struct nvkm_mm *mm, struct nvkm_mm_node *a, u32 size)
 	if (a->length == size)
 		return a;
 
-	b = kmalloc(sizeof(*b), GFP_KERNEL);
+	b = kmem_cache_alloc(nvkm_mm_cache, GFP_KERNEL);
 	if (unlikely(b == NULL))
 		return NULL;
 
@@ -101,27 +278,88 @@ region_head(struct nvkm_mm *mm, struct nvkm_mm_node *a, u32 size)
 	a->offset += size;
 	a->length -= size;
 	list_add_tail(&b->nl_entry, &a->nl_entry);
-	if (b->type == NVKM_MM_TYPE_NONE)
-		list_add_tail(&b->fl_entry, &a->fl_entry);
+	if (b->type == NVKM_MM_TYPE_NONE) {
+		nvkm_mm_fl_update(a);
+		nvkm_mm_fl_insert(mm, b);
+	}
 
 	return b;
 }
 
-int
-nvkm_mm_head(struct nvkm_mm *mm, u8 heap, u8 type, u32 size_max, u32 size_min,
-	     u32 align, struct nvkm_mm_node **pnode)
+/* The free tree only knows region sizes, so a search for size_min alone
+ * has to reject regions that can't be aligned one at a time.  Searching
+ * for enough slack to align within first means only regions trimmed by a
+ * neighbour of another type can be rejected, the exact search is only
+ * needed when that finds nothing.
+ *
+ * Heaps are numbered in offset order, so the tree is ordered by heap too,
+ * and a search for a specific heap can start at its first (or last) free
+ * region and stop once it's passed it.
+ */
+static inline u32
+nvkm_mm_fl_size(u32 size_min, u32 slack)
+{
+	return min_t(u64, (u64)size_min + slack, U32_MAX);
+}
+
+static struct nvkm_mm_node *
+nvkm_mm_fl_heap_head(struct nvkm_mm *mm, u8 heap, u32 size)
+{
+	struct rb_node *rb = mm->free.rb_node;
+	struct nvkm_mm_node *this = NULL;
+
+	if (heap == NVKM_MM_HEAP_ANY)
+		return nvkm_mm_fl_head(rb, size);
+
+	while (rb) {
+		if (fl_node(rb)->heap >= heap) {
+			this = fl_node(rb);
+			rb = rb->rb_left;
+		} else {
+			rb = rb->rb_right;
+		}
+	}
+
+	if (this && this->length < size)
+		this = nvkm_mm_fl_next(this, size);
+	return this;
+}
+
+static struct nvkm_mm_node *
+nvkm_mm_fl_heap_tail(struct nvkm_mm *mm, u8 heap, u32 size)
+{
+	struct rb_node *rb = mm->free.rb_node;
+	struct nvkm_mm_node *this = NULL;
+
+	if (heap == NVKM_MM_HEAP_ANY)
+		return nvkm_mm_fl_tail(rb, size);
+
+	while (rb) {
+		if (fl_node(rb)->heap <= heap) {
+			this = fl_node(rb);
+			rb = rb->rb_right;
+		} else {
+			rb = rb->rb_left;
+		}
+	}
+
+	if (this && this->length < size)
+		this = nvkm_mm_fl_prev(this, size);
+	return this;
+}
+
+static struct nvkm_mm_node *
+nvkm_mm_head_find(struct nvkm_mm *mm, u8 heap, u8 type, u32 size_min,
+		  u32 mask, u32 size, u32 *ps, u32 *pe)
 {
 	struct nvkm_mm_node *prev, *this, *next;
-	u32 mask = align - 1;
-	u32 splitoff;
 	u32 s, e;
 
-	BUG_ON(type == NVKM_MM_TYPE_NONE || type == NVKM_MM_TYPE_HOLE);
-
-	list_for_each_entry(this, &mm->free, fl_entry) {
+	for (this = nvkm_mm_fl_heap_head(mm, heap, size); this;
+	     this = nvkm_mm_fl_next(this, size)) {
 		if (unlikely(heap != NVKM_MM_HEAP_ANY)) {
 			if (this->heap != heap)
-				continue;
+				break;
 		}
 		e = this->offset + this->length;
 		s = this->offset;
@@ -139,21 +377,46 @@ nvkm_mm_head(struct nvkm_mm *mm, u8 heap, u8 type, u32 size_max, u32 size_min,
 		if (s > e || e - s < size_min)
 			continue;
 
-		splitoff = s - this->offset;
-		if (splitoff && !region_head(mm, this, splitoff))
-			return -ENOMEM;
+		*ps = s;
+		*pe = e;
+		return this;
+	}
 
-		this = region_head(mm, this, min(size_max, e - s));
-		if (!this)
-			return -ENOMEM;
+	return NULL;
+}
 
-		this->type = type;
-		list_del(&this->fl_entry);
-		*pnode = this;
-		return 0;
+int
+nvkm_mm_head(struct nvkm_mm *mm, u8 heap, u8 type, u32 size_max, u32 size_min,
+	     u32 align, struct nvkm_mm_node **pnode)
+{
+	struct nvkm_mm_node *this;
+	u32 mask = align - 1;
+	u32 size = nvkm_mm_fl_size(size_min, mask * 2);
+	u32 splitoff;
+	u32 s, e;
+
+	BUG_ON(type == NVKM_MM_TYPE_NONE || type == NVKM_MM_TYPE_HOLE);
+
+	this = nvkm_mm_head_find(mm, heap, type, size_min, mask, size, &s, &e);
+	if (!this && size != size_min) {
+		this = nvkm_mm_head_find(mm, heap, type, size_min, mask,
+					 size_min, &s, &e);
 	}
+	if (!this)
+		return -ENOSPC;
+
+	splitoff = s - this->offset;
+	if (splitoff && !region_head(mm, this, splitoff))
+		return -ENOMEM;
+
+	this = region_head(mm, this, min(size_max, e - s));
+	if (!this)
+		return -ENOMEM;
 
-	return -ENOSPC;
+	this->type = type;
+	nvkm_mm_fl_remove(mm, this);
+	*pnode = this;
+	return 0;
 }
 
 static struct nvkm_mm_node *
@@ -164,7 +427,7 @@ region_tail(struct nvkm_mm *mm, struct nvkm_mm_node *a, u32 size)
 	if (a->length == size)
 		return a;
 
-	b = kmalloc(sizeof(*b), GFP_KERNEL);
+	b = kmem_cache_alloc(nvkm_mm_cache, GFP_KERNEL);
 	if (unlikely(b == NULL))
 		return NULL;
 
@@ -175,28 +438,28 @@ region_tail(struct nvkm_mm *mm, struct nvkm_mm_node *a, u32 size)
 	b->type    = a->type;
 
 	list_add(&b->nl_entry, &a->nl_entry);
-	if (b->type == NVKM_MM_TYPE_NONE)
-		list_add(&b->fl_entry, &a->fl_entry);
+	if (b->type == NVKM_MM_TYPE_NONE) {
+		nvkm_mm_fl_update(a);
+		nvkm_mm_fl_insert(mm, b);
+	}
 
 	return b;
 }
 
-int
-nvkm_mm_tail(struct nvkm_mm *mm, u8 heap, u8 type, u32 size_max, u32 size_min,
-	     u32 align, struct nvkm_mm_node **pnode)
+static struct nvkm_mm_node *
+nvkm_mm_tail_find(struct nvkm_mm *mm, u8 heap, u8 type, u32 size_min,
+		  u32 mask, u32 size, u32 *pa, u32 *pe, u32 *pc)
 {
 	struct nvkm_mm_node *prev, *this, *next;
-	u32 mask = align - 1;
 
-	BUG_ON(type == NVKM_MM_TYPE_NONE || type == NVKM_MM_TYPE_HOLE);
-
-	list_for_each_entry_reverse(this, &mm->free, fl_entry) {
+	for (this = nvkm_mm_fl_heap_tail(mm, heap, size); this;
+	     this = nvkm_mm_fl_prev(this, size)) {
 		u32 e = this->offset + this->length;
 		u32 s = this->offset;
 		u32 c = 0, a;
 		if (unlikely(heap != NVKM_MM_HEAP_ANY)) {
 			if (this->heap != heap)
-				continue;
+				break;
 		}
 
 		prev = node(this, prev);
@@ -214,24 +477,50 @@ nvkm_mm_tail(struct nvkm_mm *mm, u8 heap, u8 type, u32 size_max, u32 size_min,
 		if (s > e || a < size_min)
 			continue;
 
-		a  = min(a, size_max);
-		s  = (e - a) & ~mask;
-		c += (e - s) - a;
+		*pa = a;
+		*pe = e;
+		*pc = c;
+		return this;
+	}
 
-		if (c && !region_tail(mm, this, c))
-			return -ENOMEM;
+	return NULL;
+}
 
-		this = region_tail(mm, this, a);
-		if (!this)
-			return -ENOMEM;
+int
+nvkm_mm_tail(struct nvkm_mm *mm, u8 heap, u8 type, u32 size_max, u32 size_min,
+	     u32 align, struct nvkm_mm_node **pnode)
+{
+	struct nvkm_mm_node *this;
+	u32 mask = align - 1;
+	u32 size = nvkm_mm_fl_size(size_min, mask);
+	u32 s, e, c, a;
 
-		this->type = type;
-		list_del(&this->fl_entry);
-		*pnode = this;
-		return 0;
+	BUG_ON(type == NVKM_MM_TYPE_NONE || type == NVKM_MM_TYPE_HOLE);
+
+	this = nvkm_mm_tail_find(mm, heap, type, size_min, mask, size,
+				 &a, &e, &c);
+	if (!this && size != size_min) {
+		this = nvkm_mm_tail_find(mm, heap, type, size_min, mask,
+					 size_min, &a, &e, &c);
 	}
+	if (!this)
+		return -ENOSPC;
 
-	return -ENOSPC;
+	a  = min(a, size_max);
+	s  = (e - a) & ~mask;
+	c += (e - s) - a;
+
+	if (c && !region_tail(mm, this, c))
+		return -ENOMEM;
+
+	this = region_tail(mm, this, a);
+	if (!this)
+		return -ENOMEM;
+
+	this->type = type;
+	nvkm_mm_fl_remove(mm, this);
+	*pnode = this;
+	return 0;
 }
 
 int
@@ -245,7 +534,8 @@ nvkm_mm_init(struct nvkm_mm *mm, u32 offset, u32 length, u32 block)
 		next = prev->offset + prev->length;
 		if (next != offset) {
 			BUG_ON(next > offset);
-			if (!(node = kzalloc(sizeof(*node), GFP_KERNEL)))
+			node = kmem_cache_zalloc(nvkm_mm_cache, GFP_KERNEL);
+			if (!node)
 				return -ENOMEM;
 			node->type   = NVKM_MM_TYPE_HOLE;
 			node->offset = next;
@@ -254,15 +544,21 @@ nvkm_mm_init(struct nvkm_mm *mm, u32 offset, u32 length, u32 block)
 		}
 		BUG_ON(block != mm->block_size);
 	} else {
+		int ret = nvkm_mm_cache_get();
+		if (ret)
+			return ret;
 		INIT_LIST_HEAD(&mm->nodes);
-		INIT_LIST_HEAD(&mm->free);
+		mm->free = RB_ROOT;
 		mm->block_size = block;
 		mm->heap_nodes = 0;
 	}
 
-	node = kzalloc(sizeof(*node), GFP_KERNEL);
-	if (!node)
+	node = kmem_cache_zalloc(nvkm_mm_cache, GFP_KERNEL);
+	if (!node) {
+		if (!mm->heap_nodes)
+			nvkm_mm_cache_put();
 		return -ENOMEM;
+	}
 
 	if (length) {
 		node->offset  = roundup(offset, mm->block_size);
@@ -271,7 +567,7 @@ nvkm_mm_init(struct nvkm_mm *mm, u32 offset, u32 length, u32 block)
 	}
 
 	list_add_tail(&node->nl_entry, &mm->nodes);
-	list_add_tail(&node->fl_entry, &mm->free);
+	nvkm_mm_fl_insert(mm, node);
 	node->heap = ++mm->heap_nodes;
 	return 0;
 }
@@ -296,9 +592,10 @@ nvkm_mm_fini(struct nvkm_mm *mm)
 
 	list_for_each_entry_safe(node, temp, &mm->nodes, nl_entry) {
 		list_del(&node->nl_entry);
-		kfree(node);
+		kmem_cache_free(nvkm_mm_cache, node);
 	}
 
 	mm->heap_nodes = 0;
+	nvkm_mm_cache_put();
 	return 0;
 }
@@ -138,7 +138,9 @@ nvkm_notify_init(struct nvkm_object *object, struct nvkm_event *event,
 	int ret = -ENODEV;
 	if ((notify->event = event), event->refs) {
 		ret = event->func->ctor(object, data, size, notify);
-		if (ret == 0 && (ret = -EINVAL, notify->size == reply)) {
+		if (ret == 0 && (ret = -EINVAL, notify->size == reply) &&
+		    notify->index < event->index_nr &&
+		    !(notify->types & ~GENMASK(event->types_nr - 1, 0))) {
 			notify->flags = 0;
 			notify->block = 1;
 			notify->func = func;
@@ -153,7 +155,9 @@ nvkm_notify_init(struct nvkm_object *object, struct nvkm_event *event,
 		}
 		if (ret == 0) {
 			spin_lock_irqsave(&event->list_lock, flags);
-			list_add_tail(&notify->head, &event->list);
+			list_add_tail(&notify->head,
+				      nvkm_event_list(event, notify->types,
+						      notify->index));
 			spin_unlock_irqrestore(&event->list_lock, flags);
 		}
 	}
@@ -186,6 +186,163 @@ fail:
 	return ret;
 }
 
+/* The classes an object can create children of are cached the first time
+ * they're asked for, in the order sclass() enumerates them, along with an
+ * index sorted by class id for lookups from nvkm_ioctl_new().
+ *
+ * Engines going away (or coming back) can change what's available, so the
+ * cache is tagged with a generation that nvkm_object_sclass_flush() bumps.
+ */
+struct nvkm_object_sclass {
+	u32 gen;
+	int count;
+	int *sorted;
+	struct nvkm_oclass oclass[];
+};
+
+static atomic_t nvkm_object_sclass_gen;
+static DEFINE_SPINLOCK(nvkm_object_sclass_lock);
+
+void
+nvkm_object_sclass_flush(void)
+{
+	atomic_inc(&nvkm_object_sclass_gen);
+}
+
+static int
+nvkm_object_sclass_get(struct nvkm_object *object, int index,
+		       struct nvkm_oclass *oclass)
+{
+	memset(oclass, 0x00, sizeof(*oclass));
+	oclass->client = object->client;
+	oclass->parent = object;
+	return object->func->sclass(object, index, oclass);
+}
+
+static struct nvkm_object_sclass *
+nvkm_object_sclass_new(struct nvkm_object *object, u32 gen)
+{
+	struct nvkm_object_sclass *cache;
+	struct nvkm_oclass oclass;
+	int count = 0, i, j;
+	s32 id;
+
+	while (nvkm_object_sclass_get(object, count, &oclass) == 0)
+		count++;
+
+	cache = kmalloc(sizeof(*cache) + count * (sizeof(cache->oclass[0]) +
+						  sizeof(cache->sorted[0])),
+			GFP_KERNEL);
+	if (!cache)
+		return NULL;
+
+	cache->gen = gen;
+	cache->count = count;
+	cache->sorted = (int *)&cache->oclass[count];
+
+	for (i = 0; i < count; i++) {
+		if (WARN_ON(nvkm_object_sclass_get(object, i,
+						   &cache->oclass[i]))) {
+			kfree(cache);
+			return NULL;
+		}
+
+		/* stable, so the first of any duplicates is found first */
+		id = cache->oclass[i].base.oclass;
+		for (j = i; j > 0; j--) {
+			if (cache->oclass[cache->sorted[j - 1]].base.oclass <= id)
+				break;
+			cache->sorted[j] = cache->sorted[j - 1];
+		}
+		cache->sorted[j] = i;
+	}
+
+	return cache;
+}
+
+/* returns with nvkm_object_sclass_lock held on success */
+static struct nvkm_object_sclass *
+nvkm_object_sclass_cache(struct nvkm_object *object)
+{
+	struct nvkm_object_sclass *cache, *prev;
+	u32 gen = atomic_read(&nvkm_object_sclass_gen);
+
+	spin_lock(&nvkm_object_sclass_lock);
+	if (object->sclass && object->sclass->gen == gen)
+		return object->sclass;
+	spin_unlock(&nvkm_object_sclass_lock);
+
+	if (!(cache = nvkm_object_sclass_new(object, gen)))
+		return NULL;
+
+	spin_lock(&nvkm_object_sclass_lock);
+	prev = object->sclass;
+	if (prev && prev->gen == gen) {
+		/* somebody else got there first */
+		kfree(cache);
+		return prev;
+	}
+	object->sclass = cache;
+	kfree(prev);
+	return cache;
+}
+
+int
+nvkm_object_sclass(struct nvkm_object *object, int index,
+		   struct nvkm_oclass *oclass)
+{
+	struct nvkm_object_sclass *cache;
+	int ret = -EINVAL;
+
+	if (!object->func->sclass)
+		return -ENODEV;
+
+	if (!(cache = nvkm_object_sclass_cache(object)))
+		return -ENOMEM;
+
+	if (index < cache->count) {
+		*oclass = cache->oclass[index];
+		ret = 0;
+	}
+
+	spin_unlock(&nvkm_object_sclass_lock);
+	return ret;
+}
+
+int
+nvkm_object_sclass_find(struct nvkm_object *object, s32 id,
+			struct nvkm_oclass *oclass)
+{
+	struct nvkm_object_sclass *cache;
+	int l = 0, h, i, ret = -EINVAL;
+
+	if (!object->func->sclass)
+		return -ENODEV;
+
+	if (!(cache = nvkm_object_sclass_cache(object)))
+		return -ENOMEM;
+
+	h = cache->count;
+	while (l < h) {
+		int m = (l + h) / 2;
+		if (cache->oclass[cache->sorted[m]].base.oclass < id)
+			l = m + 1;
+		else
+			h = m;
+	}
+
+	if (l < cache->count) {
+		i = cache->sorted[l];
+		if (cache->oclass[i].base.oclass == id) {
+			*oclass = cache->oclass[i];
+			ret = 0;
+		}
+	}
+
+	spin_unlock(&nvkm_object_sclass_lock);
+	return ret;
+}
+
 void *
 nvkm_object_dtor(struct nvkm_object *object)
 {
@@ -200,6 +357,8 @@ nvkm_object_dtor(struct nvkm_object *object)
 	}
 
 	nvif_debug(object, "destroy running...\n");
+	kfree(object->sclass);
+	object->sclass = NULL;
 	if (object->func->dtor)
 		data = object->func->dtor(object);
 	nvkm_engine_unref(&object->engine);
@@ -233,6 +392,7 @@ nvkm_object_ctor(const struct nvkm_object_func *func,
 	INIT_LIST_HEAD(&object->head);
 	INIT_LIST_HEAD(&object->tree);
 	RB_CLEAR_NODE(&object->node);
+	object->sclass = NULL;
 	WARN_ON(oclass->engine && !object->engine);
 }
 
@@ -36,22 +36,84 @@ nvkm_ramht_hash(struct nvkm_ramht *ramht, int chid, u32 handle)
 	return hash;
 }
 
-struct nvkm_gpuobj *
-nvkm_ramht_search(struct nvkm_ramht *ramht, int chid, u32 handle)
+/* The hash above, and linear probing from it, are what the hardware uses
+ * to find an object, so slot placement can't change.  Lookups from the
+ * host side instead go through a separate index with a better-mixing
+ * hash, which stays short however clustered the hardware table gets.
+ */
+#define NVKM_RAMHT_INDEX_EMPTY -1
+#define NVKM_RAMHT_INDEX_TOMB  -2
+
+static u32
+nvkm_ramht_index_hash(struct nvkm_ramht *ramht, int chid, u32 handle)
 {
-	u32 co, ho;
+	return ((handle * 0x9e3779b1) ^ (chid * 0x85ebca6b)) &
+	       ramht->index_mask;
+}
 
-	co = ho = nvkm_ramht_hash(ramht, chid, handle);
-	do {
-		if (ramht->data[co].chid == chid) {
-			if (ramht->data[co].handle == handle)
-				return ramht->data[co].inst;
-		}
+static int *
+nvkm_ramht_index_find(struct nvkm_ramht *ramht, int chid, u32 handle)
+{
+	u32 i = nvkm_ramht_index_hash(ramht, chid, handle), n;
+
+	for (n = 0; n <= ramht->index_mask; n++) {
+		int co = ramht->index[i];
+		if (co == NVKM_RAMHT_INDEX_EMPTY)
+			break;
+		if (co >= 0 && ramht->data[co].chid == chid &&
+		    ramht->data[co].handle == handle)
+			return &ramht->index[i];
+		i = (i + 1) & ramht->index_mask;
+	}
 
-		if (++co >= ramht->size)
-			co = 0;
-	} while (co != ho);
+	return NULL;
+}
+
+static void
+nvkm_ramht_index_insert(struct nvkm_ramht *ramht, int co)
+{
+	struct nvkm_ramht_data *data = &ramht->data[co];
+	u32 i = nvkm_ramht_index_hash(ramht, data->chid, data->handle);
+
+	while (ramht->index[i] >= 0)
+		i = (i + 1) & ramht->index_mask;
+	if (ramht->index[i] == NVKM_RAMHT_INDEX_TOMB)
+		ramht->index_tomb--;
+	ramht->index[i] = co;
+}
+
+static void
+nvkm_ramht_index_rebuild(struct nvkm_ramht *ramht)
+{
+	int i;
 
+	for (i = 0; i <= ramht->index_mask; i++)
+		ramht->index[i] = NVKM_RAMHT_INDEX_EMPTY;
+	ramht->index_tomb = 0;
+
+	for (i = 0; i < ramht->size; i++) {
+		if (ramht->data[i].chid >= 0)
+			nvkm_ramht_index_insert(ramht, i);
+	}
+}
+
+static void
+nvkm_ramht_index_remove(struct nvkm_ramht *ramht, int *index)
+{
+	*index = NVKM_RAMHT_INDEX_TOMB;
+	/* the index is sized at twice the table, so live entries can only
+	 * ever fill half of it, rebuild before tombstones eat the rest
+	 */
+	if (++ramht->index_tomb > (ramht->index_mask + 1) / 4)
+		nvkm_ramht_index_rebuild(ramht);
+}
+
+struct nvkm_gpuobj *
+nvkm_ramht_search(struct nvkm_ramht *ramht, int chid, u32 handle)
+{
+	int *index = nvkm_ramht_index_find(ramht, chid, handle);
+	if (index)
+		return ramht->data[*index].inst;
 	return NULL;
 }
 
@@ -98,31 +160,49 @@ nvkm_ramht_update(struct nvkm_ramht *ramht, int co, struct nvkm_object *object,
 void
 nvkm_ramht_remove(struct nvkm_ramht *ramht, int cookie)
 {
-	if (--cookie >= 0)
+	struct nvkm_ramht_data *data;
+	int *index;
+
+	if (--cookie >= 0) {
+		data = &ramht->data[cookie];
+		if (data->chid >= 0) {
+			index = nvkm_ramht_index_find(ramht, data->chid,
+						      data->handle);
+			if (!WARN_ON(!index || *index != cookie))
+				nvkm_ramht_index_remove(ramht, index);
+			ramht->used--;
+		}
 		nvkm_ramht_update(ramht, cookie, NULL, -1, 0, 0, 0);
+	}
 }
 
 int
 nvkm_ramht_insert(struct nvkm_ramht *ramht, struct nvkm_object *object,
 		  int chid, int addr, u32 handle, u32 context)
 {
-	u32 co, ho;
+	u32 co;
+	int ret, n;
 
-	if (nvkm_ramht_search(ramht, chid, handle))
+	if (nvkm_ramht_index_find(ramht, chid, handle))
 		return -EEXIST;
+	if (ramht->used >= ramht->size)
+		return -ENOSPC;
 
-	co = ho = nvkm_ramht_hash(ramht, chid, handle);
-	do {
-		if (ramht->data[co].chid < 0) {
-			return nvkm_ramht_update(ramht, co, object, chid,
-						 addr, handle, context);
-		}
-
+	co = nvkm_ramht_hash(ramht, chid, handle);
+	for (n = 1; ramht->data[co].chid >= 0; n++) {
 		if (++co >= ramht->size)
 			co = 0;
-	} while (co != ho);
+	}
 
-	return -ENOSPC;
+	ret = nvkm_ramht_update(ramht, co, object, chid, addr, handle, context);
+	if (ret > 0) {
+		nvkm_ramht_index_insert(ramht, co);
+		ramht->used++;
+		ramht->peak = max(ramht->peak, ramht->used);
+		ramht->probe = max(ramht->probe, n);
+	}
+
+	return ret;
 }
 
 void
@@ -130,6 +210,10 @@ nvkm_ramht_del(struct nvkm_ramht **pramht)
 {
 	struct nvkm_ramht *ramht = *pramht;
 	if (ramht) {
+		nvdev_debug(ramht->device, "ramht: %d/%d entries at peak "
+			    "(%d%% load), longest probe %d\n", ramht->peak,
+			    ramht->size, ramht->peak * 100 / ramht->size,
+			    ramht->probe);
 		nvkm_gpuobj_del(&ramht->gpuobj);
 		vfree(*pramht);
 		*pramht = NULL;
@@ -141,10 +225,12 @@ nvkm_ramht_new(struct nvkm_device *device, u32 size, u32 align,
 	       struct nvkm_gpuobj *parent, struct nvkm_ramht **pramht)
 {
 	struct nvkm_ramht *ramht;
+	u32 index = 2 << order_base_2(size >> 3);
 	int ret, i;
 
 	if (!(ramht = *pramht = vzalloc(sizeof(*ramht) +
-					(size >> 3) * sizeof(*ramht->data))))
+					(size >> 3) * sizeof(*ramht->data) +
+					index * sizeof(*ramht->index))))
 		return -ENOMEM;
 
 	ramht->device = device;
@@ -154,6 +240,10 @@ nvkm_ramht_new(struct nvkm_device *device, u32 size, u32 align,
 	for (i = 0; i < ramht->size; i++)
 		ramht->data[i].chid = -1;
 
+	ramht->index = (int *)&ramht->data[ramht->size];
+	ramht->index_mask = index - 1;
+	nvkm_ramht_index_rebuild(ramht);
+
 	ret = nvkm_gpuobj_new(ramht->device, size, align, true,
 			      ramht->parent, &ramht->gpuobj);
 	if (ret)
@@ -90,28 +90,76 @@ nvkm_subdev_intr(struct nvkm_subdev *subdev)
 		subdev->func->intr(subdev);
 }
 
+struct nvkm_subdev_stat_base {
+	struct nvkm_device_mmio_stat mmio;
+	s64 time;
+};
+
+/* Register accesses and waits are charged to the stage that's running on
+ * the task making them, so other subdevs initialising in parallel, and
+ * interrupt handlers, aren't counted here.
+ */
+static void
+nvkm_subdev_stat_begin(struct nvkm_subdev *subdev,
+		       struct nvkm_subdev_stat_base *base)
+{
+	struct nvkm_device *device = subdev->device;
+
+	memset(&base->mmio, 0x00, sizeof(base->mmio));
+	base->mmio.task = current;
+	base->time = ktime_to_us(ktime_get());
+
+	spin_lock(&device->mmio.lock);
+	list_add(&base->mmio.head, &device->mmio.list);
+	spin_unlock(&device->mmio.lock);
+	atomic_inc(&device->mmio.stat);
+}
+
+static s64
+nvkm_subdev_stat_end(struct nvkm_subdev *subdev,
+		     struct nvkm_subdev_stat_base *base, int type)
+{
+	struct nvkm_device *device = subdev->device;
+	struct nvkm_subdev_stat *stat = &subdev->stat[type];
+
+	atomic_dec(&device->mmio.stat);
+	spin_lock(&device->mmio.lock);
+	list_del(&base->mmio.head);
+	spin_unlock(&device->mmio.lock);
+
+	stat->time = ktime_to_us(ktime_get()) - base->time;
+	stat->wait = base->mmio.wait;
+	stat->rd = base->mmio.rd;
+	stat->wr = base->mmio.wr;
+	return stat->time;
+}
+
 int
 nvkm_subdev_fini(struct nvkm_subdev *subdev, bool suspend)
 {
 	struct nvkm_device *device = subdev->device;
 	const char *action = suspend ? "suspend" : "fini";
+	struct nvkm_subdev_stat_base base;
 	s64 time;
 
 	nvkm_trace(subdev, "%s running...\n", action);
-	time = ktime_to_us(ktime_get());
+	nvkm_subdev_stat_begin(subdev, &base);
 
 	if (subdev->func->fini) {
 		int ret = subdev->func->fini(subdev, suspend);
 		if (ret) {
 			nvkm_error(subdev, "%s failed, %d\n", action, ret);
-			if (suspend)
+			if (suspend) {
+				nvkm_subdev_stat_end(subdev, &base,
+						     NVKM_SUBDEV_STAT_FINI);
 				return ret;
+			}
 		}
 	}
 
 	nvkm_mc_reset(device, subdev->index);
 
-	time = ktime_to_us(ktime_get()) - time;
+	time = nvkm_subdev_stat_end(subdev, &base, NVKM_SUBDEV_STAT_FINI);
 	nvkm_trace(subdev, "%s completed in %lldus\n", action, time);
 	return 0;
 }
@@ -119,20 +167,23 @@ nvkm_subdev_fini(struct nvkm_subdev *subdev, bool suspend)
 int
 nvkm_subdev_preinit(struct nvkm_subdev *subdev)
 {
+	struct nvkm_subdev_stat_base base;
 	s64 time;
 
 	nvkm_trace(subdev, "preinit running...\n");
-	time = ktime_to_us(ktime_get());
+	nvkm_subdev_stat_begin(subdev, &base);
 
 	if (subdev->func->preinit) {
 		int ret = subdev->func->preinit(subdev);
 		if (ret) {
+			nvkm_subdev_stat_end(subdev, &base,
+					     NVKM_SUBDEV_STAT_PREINIT);
 			nvkm_error(subdev, "preinit failed, %d\n", ret);
 			return ret;
 		}
 	}
 
-	time = ktime_to_us(ktime_get()) - time;
+	time = nvkm_subdev_stat_end(subdev, &base, NVKM_SUBDEV_STAT_PREINIT);
 	nvkm_trace(subdev, "preinit completed in %lldus\n", time);
 	return 0;
 }
@@ -140,36 +191,40 @@ nvkm_subdev_preinit(struct nvkm_subdev *subdev)
 int
 nvkm_subdev_init(struct nvkm_subdev *subdev)
 {
+	struct nvkm_subdev_stat_base base;
 	s64 time;
 	int ret;
 
 	nvkm_trace(subdev, "init running...\n");
-	time = ktime_to_us(ktime_get());
 
 	if (subdev->func->oneinit && !subdev->oneinit) {
-		s64 time;
 		nvkm_trace(subdev, "one-time init running...\n");
-		time = ktime_to_us(ktime_get());
+		nvkm_subdev_stat_begin(subdev, &base);
 		ret = subdev->func->oneinit(subdev);
+		time = nvkm_subdev_stat_end(subdev, &base,
+					    NVKM_SUBDEV_STAT_ONEINIT);
 		if (ret) {
 			nvkm_error(subdev, "one-time init failed, %d\n", ret);
 			return ret;
 		}
 
 		subdev->oneinit = true;
-		time = ktime_to_us(ktime_get()) - time;
 		nvkm_trace(subdev, "one-time init completed in %lldus\n", time);
 	}
 
+	nvkm_subdev_stat_begin(subdev, &base);
+
 	if (subdev->func->init) {
 		ret = subdev->func->init(subdev);
 		if (ret) {
+			nvkm_subdev_stat_end(subdev, &base,
+					     NVKM_SUBDEV_STAT_INIT);
 			nvkm_error(subdev, "init failed, %d\n", ret);
 			return ret;
 		}
 	}
 
-	time = ktime_to_us(ktime_get()) - time;
+	time = nvkm_subdev_stat_end(subdev, &base, NVKM_SUBDEV_STAT_INIT);
 	nvkm_trace(subdev, "init completed in %lldus\n", time);
 	return 0;
 }
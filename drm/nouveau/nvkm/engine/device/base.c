@@ -49,6 +49,8 @@ nvkm_device_find(u64 handle)
 	struct nvkm_device *device;
 	mutex_lock(&nv_devices_mutex);
 	device = nvkm_device_find_locked(handle);
+	if (device && !device->ready)
+		device = NULL;
 	mutex_unlock(&nv_devices_mutex);
 	return device;
 }
@@ -60,6 +62,8 @@ nvkm_device_list(u64 *name, int size)
 	int nr = 0;
 	mutex_lock(&nv_devices_mutex);
 	list_for_each_entry(device, &nv_devices, head) {
+		if (!device->ready)
+			continue;
 		if (nr++ < size)
 			name[nr - 1] = device->handle;
 	}
@@ -67,6 +71,29 @@ nvkm_device_list(u64 *name, int size)
 	return nr;
 }
 
+/* charges register accesses, and time spent waiting, to the subdev stage
+ * being timed on the current task, if there is one
+ */
+void
+nvkm_device_mmio_stat(struct nvkm_device *device, u64 rd, u64 wr, u64 wait)
+{
+	struct nvkm_device_mmio_stat *stat;
+
+	if (in_interrupt())
+		return;
+
+	spin_lock(&device->mmio.lock);
+	list_for_each_entry(stat, &device->mmio.list, head) {
+		if (stat->task == current) {
+			stat->rd += rd;
+			stat->wr += wr;
+			stat->wait += wait;
+			break;
+		}
+	}
+	spin_unlock(&device->mmio.lock);
+}
+
 static const struct nvkm_device_chip
 null_chipset = {
 	.name = "NULL",
@@ -2384,6 +2411,9 @@ nvkm_device_preinit(struct nvkm_device *device)
 	if (ret)
 		goto fail;
 
+	/* disable_mask may have changed which engines are present */
+	nvkm_object_sclass_flush();
+
 	time = ktime_to_us(ktime_get()) - time;
 	nvdev_trace(device, "preinit completed in %lldus\n", time);
 	return 0;
@@ -2393,10 +2423,132 @@ fail:
 	return ret;
 }
 
+/* Subdevs that need to have completed init before the given one can start.
+ *
+ * Anything not listed here waits for every subdev before it, exactly as
+ * with the serial walk.  The entries that are listed only touch state of
+ * their own, or are chained behind whatever they share registers with
+ * (PMC_ENABLE for FIFO/GR/PM, GPIO lines for VOLT/THERM).  Dependencies
+ * always point at lower indices, so the ordering can't deadlock.
+ */
+#define NVKM_DEVICE_INIT_CORE   (BIT_ULL(NVKM_SUBDEV_BAR + 1) - 1)
+#define NVKM_DEVICE_INIT_SUBDEV (BIT_ULL(NVKM_ENGINE_BSP) - 1)
+
+static u64
+nvkm_device_init_deps(int index, bool parallel)
+{
+	if (parallel) {
+		switch (index) {
+		case NVKM_SUBDEV_PMU:
+		case NVKM_SUBDEV_VOLT:
+		case NVKM_SUBDEV_ICCSENSE:
+			return NVKM_DEVICE_INIT_CORE;
+		case NVKM_SUBDEV_THERM:
+			return NVKM_DEVICE_INIT_CORE |
+			       BIT_ULL(NVKM_SUBDEV_VOLT);
+		case NVKM_ENGINE_GR:
+		case NVKM_ENGINE_SW:
+			return NVKM_DEVICE_INIT_SUBDEV |
+			       BIT_ULL(NVKM_ENGINE_FIFO);
+		case NVKM_ENGINE_ME:
+		case NVKM_ENGINE_PM:
+			return NVKM_DEVICE_INIT_SUBDEV |
+			       BIT_ULL(NVKM_ENGINE_FIFO) |
+			       BIT_ULL(NVKM_ENGINE_GR);
+		default:
+			if (index >= NVKM_ENGINE_BSP)
+				return NVKM_DEVICE_INIT_SUBDEV;
+			break;
+		}
+	}
+
+	return BIT_ULL(index) - 1;
+}
+
+struct nvkm_device_init_work {
+	struct work_struct work;
+	struct nvkm_subdev *subdev;
+	int ret;
+};
+
+static void
+nvkm_device_init_work(struct work_struct *w)
+{
+	struct nvkm_device_init_work *work =
+		container_of(w, typeof(*work), work);
+	work->ret = nvkm_subdev_init(work->subdev);
+}
+
+/* Runs subdev init in waves, each wave being everything whose dependencies
+ * have completed.  The lowest index of a wave is initialised by the caller,
+ * the rest are handed to a queue of our own, not the system one, as engine
+ * init can itself flush work that's queued there.  Without the queue, init
+ * falls back to the serial walk.  *pinit returns the subdevs that were
+ * started, whether or not they succeeded, so they can be cleaned up on
+ * failure.
+ */
+static int
+nvkm_device_init_subdev(struct nvkm_device *device, u64 *pinit)
+{
+	struct nvkm_device_init_work *work = NULL;
+	struct workqueue_struct *wq = NULL;
+	bool parallel = nvkm_boolopt(device->cfgopt, "NvInitParallel", true);
+	u64 todo = 0, wave;
+	int ret = 0, i, j;
+
+	if (parallel) {
+		work = kcalloc(NVKM_SUBDEV_NR, sizeof(*work), GFP_KERNEL);
+		if (work)
+			wq = alloc_workqueue("nvkm-init", WQ_UNBOUND, 0);
+		if (!wq)
+			parallel = false;
+	}
+
+	for (i = 0; i < NVKM_SUBDEV_NR; i++) {
+		if (nvkm_device_subdev(device, i))
+			todo |= BIT_ULL(i);
+	}
+
+	while (ret == 0 && todo) {
+		for (wave = 0, i = 0; i < NVKM_SUBDEV_NR; i++) {
+			if ((todo & BIT_ULL(i)) &&
+			    !(nvkm_device_init_deps(i, parallel) & todo))
+				wave |= BIT_ULL(i);
+		}
+
+		i = __ffs64(wave);
+		for (j = i + 1; j < NVKM_SUBDEV_NR; j++) {
+			if (wave & BIT_ULL(j)) {
+				work[j].subdev = nvkm_device_subdev(device, j);
+				INIT_WORK(&work[j].work, nvkm_device_init_work);
+				queue_work(wq, &work[j].work);
+			}
+		}
+
+		ret = nvkm_subdev_init(nvkm_device_subdev(device, i));
+
+		if (wq)
+			flush_workqueue(wq);
+		for (j = i + 1; j < NVKM_SUBDEV_NR; j++) {
+			if ((wave & BIT_ULL(j)) && ret == 0)
+				ret = work[j].ret;
+		}
+
+		*pinit |= wave;
+		todo &= ~wave;
+	}
+
+	if (wq)
+		destroy_workqueue(wq);
+	kfree(work);
+	return ret;
+}
+
 int
 nvkm_device_init(struct nvkm_device *device)
 {
 	struct nvkm_subdev *subdev;
+	u64 init = 0;
 	int ret, i;
 	s64 time;
 
@@ -2415,13 +2567,9 @@ nvkm_device_init(struct nvkm_device *device)
 			goto fail;
 	}
 
-	for (i = 0; i < NVKM_SUBDEV_NR; i++) {
-		if ((subdev = nvkm_device_subdev(device, i))) {
-			ret = nvkm_subdev_init(subdev);
-			if (ret)
-				goto fail_subdev;
-		}
-	}
+	ret = nvkm_device_init_subdev(device, &init);
+	if (ret)
+		goto fail_subdev;
 
 	nvkm_acpi_init(device);
 
@@ -2430,10 +2578,11 @@ nvkm_device_init(struct nvkm_device *device)
 	return 0;
 
 fail_subdev:
-	do {
-		if ((subdev = nvkm_device_subdev(device, i)))
+	for (i = NVKM_SUBDEV_NR - 1; i >= 0; i--) {
+		if ((init & BIT_ULL(i)) &&
+		    (subdev = nvkm_device_subdev(device, i)))
 			nvkm_subdev_fini(subdev, false);
-	} while (--i >= 0);
+	}
 
 fail:
 	nvkm_device_fini(device, false);
@@ -2479,6 +2628,7 @@ nvkm_device_ctor(const struct nvkm_device_func *func,
 		 bool detect, bool mmio, u64 subdev_mask,
 		 struct nvkm_device *device)
 {
+	struct nvkm_device *temp;
 	struct nvkm_subdev *subdev;
 	u64 mmio_base, mmio_size;
 	u32 boot0, strap;
@@ -2486,10 +2636,6 @@ nvkm_device_ctor(const struct nvkm_device_func *func,
 	int ret = -EEXIST;
 	int i;
 
-	mutex_lock(&nv_devices_mutex);
-	if (nvkm_device_find_locked(handle))
-		goto done;
-
 	device->func = func;
 	device->quirk = quirk;
 	device->dev = dev;
@@ -2498,8 +2644,29 @@ nvkm_device_ctor(const struct nvkm_device_func *func,
 	device->cfgopt = cfg;
 	device->dbgopt = dbg;
 	device->name = name;
-	list_add_tail(&device->head, &nv_devices);
 	device->debug = nvkm_dbgopt(device->dbgopt, "device");
+	spin_lock_init(&device->mmio.lock);
+	INIT_LIST_HEAD(&device->mmio.list);
+
+	/* the list is kept sorted by handle, so devices are enumerated in
+	 * the same order no matter which order they were probed in, the
+	 * lock is only held to claim the handle so devices can be
+	 * constructed in parallel
+	 *
+	 * the device stays hidden from lookups until it's been constructed
+	 */
+	mutex_lock(&nv_devices_mutex);
+	if (nvkm_device_find_locked(handle)) {
+		mutex_unlock(&nv_devices_mutex);
+		return ret;
+	}
+
+	list_for_each_entry(temp, &nv_devices, head) {
+		if (temp->handle > handle)
+			break;
+	}
+	list_add_tail(&device->head, &temp->head);
+	mutex_unlock(&nv_devices_mutex);
 
 	ret = nvkm_event_init(&nvkm_device_event_func, 1, 1, &device->event);
 	if (ret)
@@ -2758,8 +2925,10 @@ nvkm_device_ctor(const struct nvkm_device_func *func,
 #undef _
 	}
 
+	mutex_lock(&nv_devices_mutex);
+	device->ready = true;
+	mutex_unlock(&nv_devices_mutex);
 	ret = 0;
 done:
-	mutex_unlock(&nv_devices_mutex);
 	return ret;
 }
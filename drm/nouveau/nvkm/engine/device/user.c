@@ -141,6 +141,50 @@ nvkm_udevice_time(struct nvkm_udevice *udev, void *data, u32 size)
 	return ret;
 }
 
+static int
+nvkm_udevice_subdev_stats(struct nvkm_udevice *udev, void *data, u32 size)
+{
+	struct nvkm_object *object = &udev->object;
+	struct nvkm_device *device = udev->device;
+	struct nv_device_subdev_stats_entry_v0 *entry;
+	struct nvkm_subdev *subdev;
+	union {
+		struct nv_device_subdev_stats_v0 v0;
+	} *args = data;
+	int ret = -ENOSYS, nr = 0, i, j;
+
+	nvif_ioctl(object, "device subdev stats size %d\n", size);
+	if (!(ret = nvif_unpack(ret, &data, &size, args->v0, 0, 0, true))) {
+		nvif_ioctl(object, "device subdev stats vers %d count %d\n",
+			   args->v0.version, args->v0.count);
+		if (size != sizeof(args->v0.entry[0]) * args->v0.count)
+			return -EINVAL;
+	} else
+		return ret;
+
+	for (i = 0; i < NVKM_SUBDEV_NR; i++) {
+		if (!(subdev = nvkm_device_subdev(device, i)))
+			continue;
+
+		if (nr < args->v0.count) {
+			entry = &args->v0.entry[nr];
+			entry->index = i;
+			strncpy(entry->name, nvkm_subdev_name[i],
+				sizeof(entry->name));
+			for (j = 0; j < ARRAY_SIZE(entry->stat); j++) {
+				entry->stat[j].time = subdev->stat[j].time;
+				entry->stat[j].wait = subdev->stat[j].wait;
+				entry->stat[j].rd = subdev->stat[j].rd;
+				entry->stat[j].wr = subdev->stat[j].wr;
+			}
+		}
+		nr++;
+	}
+
+	args->v0.count = nr;
+	return 0;
+}
+
 static int
 nvkm_udevice_mthd(struct nvkm_object *object, u32 mthd, void *data, u32 size)
 {
@@ -151,6 +195,8 @@ nvkm_udevice_mthd(struct nvkm_object *object, u32 mthd, void *data, u32 size)
 		return nvkm_udevice_info(udev, data, size);
 	case NV_DEVICE_V0_TIME:
 		return nvkm_udevice_time(udev, data, size);
+	case NV_DEVICE_V0_SUBDEV_STATS:
+		return nvkm_udevice_subdev_stats(udev, data, size);
 	default:
 		break;
 	}
@@ -63,7 +63,7 @@ nvkm_disp_vblank_ctor(struct nvkm_object *object, void *data, u32 size,
 
 	if (!(ret = nvif_unpack(ret, &data, &size, req->v0, 0, 0, false))) {
 		notify->size = sizeof(struct nvif_notify_head_rep_v0);
-		if (ret = -ENXIO, req->v0.head <= disp->vblank.index_nr) {
+		if (ret = -ENXIO, req->v0.head < disp->vblank.index_nr) {
 			notify->types = 1;
 			notify->index = req->v0.head;
 			return 0;
@@ -86,6 +86,34 @@ nvkm_instobj_wr32(struct nvkm_memory *memory, u64 offset, u32 data)
 	iowrite32_native(data, nvkm_instobj(memory)->map + offset);
 }
 
+static void
+nvkm_instobj_rd(struct nvkm_memory *memory, u64 offset, void *data, u64 size)
+{
+	memcpy_fromio(data, nvkm_instobj(memory)->map + offset, size);
+}
+
+static void
+nvkm_instobj_wr(struct nvkm_memory *memory, u64 offset, const void *data,
+		u64 size)
+{
+	memcpy_toio(nvkm_instobj(memory)->map + offset, data, size);
+}
+
+static void
+nvkm_instobj_fill(struct nvkm_memory *memory, u64 offset, u32 data, u64 size)
+{
+	void __iomem *map = nvkm_instobj(memory)->map + offset;
+	u64 i;
+
+	if (!data) {
+		memset_io(map, 0x00, size);
+		return;
+	}
+
+	for (i = 0; i < size; i += 4)
+		iowrite32_native(data, map + i);
+}
+
 static void
 nvkm_instobj_map(struct nvkm_memory *memory, struct nvkm_vma *vma, u64 offset)
 {
@@ -114,6 +142,9 @@ nvkm_instobj_func = {
 	.release = nvkm_instobj_release,
 	.rd32 = nvkm_instobj_rd32,
 	.wr32 = nvkm_instobj_wr32,
+	.rd = nvkm_instobj_rd,
+	.wr = nvkm_instobj_wr,
+	.fill = nvkm_instobj_fill,
 	.map = nvkm_instobj_map,
 };
 
@@ -156,6 +187,30 @@ nvkm_instobj_wr32_slow(struct nvkm_memory *memory, u64 offset, u32 data)
 	return nvkm_wo32(iobj->parent, offset, data);
 }
 
+static void
+nvkm_instobj_rd_slow(struct nvkm_memory *memory, u64 offset, void *data,
+		     u64 size)
+{
+	struct nvkm_instobj *iobj = nvkm_instobj(memory);
+	nvkm_ro(iobj->parent, offset, data, size);
+}
+
+static void
+nvkm_instobj_wr_slow(struct nvkm_memory *memory, u64 offset, const void *data,
+		     u64 size)
+{
+	struct nvkm_instobj *iobj = nvkm_instobj(memory);
+	nvkm_wo(iobj->parent, offset, data, size);
+}
+
+static void
+nvkm_instobj_fill_slow(struct nvkm_memory *memory, u64 offset, u32 data,
+		       u64 size)
+{
+	struct nvkm_instobj *iobj = nvkm_instobj(memory);
+	nvkm_fo32(iobj->parent, offset, data, size);
+}
+
 const struct nvkm_memory_func
 nvkm_instobj_func_slow = {
 	.dtor = nvkm_instobj_dtor,
@@ -167,6 +222,9 @@ nvkm_instobj_func_slow = {
 	.release = nvkm_instobj_release_slow,
 	.rd32 = nvkm_instobj_rd32_slow,
 	.wr32 = nvkm_instobj_wr32_slow,
+	.rd = nvkm_instobj_rd_slow,
+	.wr = nvkm_instobj_wr_slow,
+	.fill = nvkm_instobj_fill_slow,
 	.map = nvkm_instobj_map,
 };
 
@@ -176,7 +234,6 @@ nvkm_instobj_new(struct nvkm_instmem *imem, u32 size, u32 align, bool zero,
 {
 	struct nvkm_memory *memory = NULL;
 	struct nvkm_instobj *iobj;
-	u32 offset;
 	int ret;
 
 	ret = imem->func->memory_new(imem, size, align, zero, &memory);
@@ -200,12 +257,10 @@ nvkm_instobj_new(struct nvkm_instmem *imem, u32 size, u32 align, bool zero,
 
 	if (!imem->func->zero && zero) {
 		void __iomem *map = nvkm_kmap(memory);
-		if (unlikely(!map)) {
-			for (offset = 0; offset < size; offset += 4)
-				nvkm_wo32(memory, offset, 0x00000000);
-		} else {
+		if (unlikely(!map))
+			nvkm_fo32(memory, 0, 0x00000000, size);
+		else
 			memset_io(map, 0x00, size);
-		}
 		nvkm_done(memory);
 	}
 
@@ -237,7 +292,6 @@ nvkm_instmem_fini(struct nvkm_subdev *subdev, bool suspend)
 {
 	struct nvkm_instmem *imem = nvkm_instmem(subdev);
 	struct nvkm_instobj *iobj;
-	int i;
 
 	if (imem->func->fini)
 		imem->func->fini(imem);
@@ -251,8 +305,7 @@ nvkm_instmem_fini(struct nvkm_subdev *subdev, bool suspend)
 			if (!iobj->suspend)
 				return -ENOMEM;
 
-			for (i = 0; i < size; i += 4)
-				iobj->suspend[i / 4] = nvkm_ro32(memory, i);
+			nvkm_ro(memory, 0, iobj->suspend, size);
 		}
 	}
 
@@ -273,14 +326,12 @@ nvkm_instmem_init(struct nvkm_subdev *subdev)
 {
 	struct nvkm_instmem *imem = nvkm_instmem(subdev);
 	struct nvkm_instobj *iobj;
-	int i;
 
 	list_for_each_entry(iobj, &imem->list, head) {
 		if (iobj->suspend) {
 			struct nvkm_memory *memory = iobj->parent;
 			u64 size = nvkm_memory_size(memory);
-			for (i = 0; i < size; i += 4)
-				nvkm_wo32(memory, i, iobj->suspend[i / 4]);
+			nvkm_wo(memory, 0, iobj->suspend, size);
 			vfree(iobj->suspend);
 			iobj->suspend = NULL;
 		}
@@ -90,6 +90,44 @@ nv04_instobj_wr32(struct nvkm_memory *memory, u64 offset, u32 data)
 	nvkm_wr32(device, 0x700000 + iobj->node->offset + offset, data);
 }
 
+static void
+nv04_instobj_rd(struct nvkm_memory *memory, u64 offset, void *data, u64 size)
+{
+	struct nv04_instobj *iobj = nv04_instobj(memory);
+	struct nvkm_device *device = iobj->imem->base.subdev.device;
+	u32 addr = 0x700000 + iobj->node->offset + offset, *ptr = data;
+	u64 i;
+
+	for (i = 0; i < size; i += 4)
+		*ptr++ = nvkm_rd32(device, addr + i);
+}
+
+static void
+nv04_instobj_wr(struct nvkm_memory *memory, u64 offset, const void *data,
+		u64 size)
+{
+	struct nv04_instobj *iobj = nv04_instobj(memory);
+	struct nvkm_device *device = iobj->imem->base.subdev.device;
+	u32 addr = 0x700000 + iobj->node->offset + offset;
+	const u32 *ptr = data;
+	u64 i;
+
+	for (i = 0; i < size; i += 4)
+		nvkm_wr32(device, addr + i, *ptr++);
+}
+
+static void
+nv04_instobj_fill(struct nvkm_memory *memory, u64 offset, u32 data, u64 size)
+{
+	struct nv04_instobj *iobj = nv04_instobj(memory);
+	struct nvkm_device *device = iobj->imem->base.subdev.device;
+	u32 addr = 0x700000 + iobj->node->offset + offset;
+	u64 i;
+
+	for (i = 0; i < size; i += 4)
+		nvkm_wr32(device, addr + i, data);
+}
+
 static void *
 nv04_instobj_dtor(struct nvkm_memory *memory)
 {
@@ -110,6 +148,9 @@ nv04_instobj_func = {
 	.release = nv04_instobj_release,
 	.rd32 = nv04_instobj_rd32,
 	.wr32 = nv04_instobj_wr32,
+	.rd = nv04_instobj_rd,
+	.wr = nv04_instobj_wr,
+	.fill = nv04_instobj_fill,
 };
 
 static int
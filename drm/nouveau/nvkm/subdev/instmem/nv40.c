@@ -89,6 +89,34 @@ nv40_instobj_wr32(struct nvkm_memory *memory, u64 offset, u32 data)
 	iowrite32_native(data, iobj->imem->iomem + iobj->node->offset + offset);
 }
 
+static void
+nv40_instobj_rd(struct nvkm_memory *memory, u64 offset, void *data, u64 size)
+{
+	struct nv40_instobj *iobj = nv40_instobj(memory);
+	memcpy_fromio(data, iobj->imem->iomem + iobj->node->offset + offset,
+		      size);
+}
+
+static void
+nv40_instobj_wr(struct nvkm_memory *memory, u64 offset, const void *data,
+		u64 size)
+{
+	struct nv40_instobj *iobj = nv40_instobj(memory);
+	memcpy_toio(iobj->imem->iomem + iobj->node->offset + offset, data,
+		    size);
+}
+
+static void
+nv40_instobj_fill(struct nvkm_memory *memory, u64 offset, u32 data, u64 size)
+{
+	struct nv40_instobj *iobj = nv40_instobj(memory);
+	void __iomem *map = iobj->imem->iomem + iobj->node->offset + offset;
+	u64 i;
+
+	for (i = 0; i < size; i += 4)
+		iowrite32_native(data, map + i);
+}
+
 static void *
 nv40_instobj_dtor(struct nvkm_memory *memory)
 {
@@ -109,6 +137,9 @@ nv40_instobj_func = {
 	.release = nv40_instobj_release,
 	.rd32 = nv40_instobj_rd32,
 	.wr32 = nv40_instobj_wr32,
+	.rd = nv40_instobj_rd,
+	.wr = nv40_instobj_wr,
+	.fill = nv40_instobj_fill,
 };
 
 static int
@@ -121,38 +121,92 @@ nv50_instobj_acquire(struct nvkm_memory *memory)
 	return NULL;
 }
 
+/* point the PRAMIN window at the 1MiB block containing offset, and return
+ * the offset within it, clamping *size to what fits inside the window
+ */
 static u32
-nv50_instobj_rd32(struct nvkm_memory *memory, u64 offset)
+nv50_instobj_window(struct nv50_instobj *iobj, u64 offset, u64 *size)
 {
-	struct nv50_instobj *iobj = nv50_instobj(memory);
 	struct nv50_instmem *imem = iobj->imem;
 	struct nvkm_device *device = imem->base.subdev.device;
 	u64 base = (iobj->mem->offset + offset) & 0xffffff00000ULL;
 	u64 addr = (iobj->mem->offset + offset) & 0x000000fffffULL;
-	u32 data;
 
 	if (unlikely(imem->addr != base)) {
 		nvkm_wr32(device, 0x001700, base >> 16);
 		imem->addr = base;
 	}
-	data = nvkm_rd32(device, 0x700000 + addr);
-	return data;
+
+	if (size)
+		*size = min_t(u64, *size, 0x100000 - addr);
+	return 0x700000 + addr;
+}
+
+static u32
+nv50_instobj_rd32(struct nvkm_memory *memory, u64 offset)
+{
+	struct nv50_instobj *iobj = nv50_instobj(memory);
+	struct nvkm_device *device = iobj->imem->base.subdev.device;
+	return nvkm_rd32(device, nv50_instobj_window(iobj, offset, NULL));
 }
 
 static void
 nv50_instobj_wr32(struct nvkm_memory *memory, u64 offset, u32 data)
 {
 	struct nv50_instobj *iobj = nv50_instobj(memory);
-	struct nv50_instmem *imem = iobj->imem;
-	struct nvkm_device *device = imem->base.subdev.device;
-	u64 base = (iobj->mem->offset + offset) & 0xffffff00000ULL;
-	u64 addr = (iobj->mem->offset + offset) & 0x000000fffffULL;
+	struct nvkm_device *device = iobj->imem->base.subdev.device;
+	nvkm_wr32(device, nv50_instobj_window(iobj, offset, NULL), data);
+}
 
-	if (unlikely(imem->addr != base)) {
-		nvkm_wr32(device, 0x001700, base >> 16);
-		imem->addr = base;
+static void
+nv50_instobj_rd(struct nvkm_memory *memory, u64 offset, void *data, u64 size)
+{
+	struct nv50_instobj *iobj = nv50_instobj(memory);
+	struct nvkm_device *device = iobj->imem->base.subdev.device;
+	u32 *ptr = data;
+
+	while (size) {
+		u64 part = size, i;
+		u32 addr = nv50_instobj_window(iobj, offset, &part);
+		for (i = 0; i < part; i += 4)
+			*ptr++ = nvkm_rd32(device, addr + i);
+		offset += part;
+		size -= part;
+	}
+}
+
+static void
+nv50_instobj_wr(struct nvkm_memory *memory, u64 offset, const void *data,
+		u64 size)
+{
+	struct nv50_instobj *iobj = nv50_instobj(memory);
+	struct nvkm_device *device = iobj->imem->base.subdev.device;
+	const u32 *ptr = data;
+
+	while (size) {
+		u64 part = size, i;
+		u32 addr = nv50_instobj_window(iobj, offset, &part);
+		for (i = 0; i < part; i += 4)
+			nvkm_wr32(device, addr + i, *ptr++);
+		offset += part;
+		size -= part;
+	}
+}
+
+static void
+nv50_instobj_fill(struct nvkm_memory *memory, u64 offset, u32 data, u64 size)
+{
+	struct nv50_instobj *iobj = nv50_instobj(memory);
+	struct nvkm_device *device = iobj->imem->base.subdev.device;
+
+	while (size) {
+		u64 part = size, i;
+		u32 addr = nv50_instobj_window(iobj, offset, &part);
+		for (i = 0; i < part; i += 4)
+			nvkm_wr32(device, addr + i, data);
+		offset += part;
+		size -= part;
 	}
-	nvkm_wr32(device, 0x700000 + addr, data);
 }
 
 static void
@@ -186,6 +240,9 @@ nv50_instobj_func = {
 	.release = nv50_instobj_release,
 	.rd32 = nv50_instobj_rd32,
 	.wr32 = nv50_instobj_wr32,
+	.rd = nv50_instobj_rd,
+	.wr = nv50_instobj_wr,
+	.fill = nv50_instobj_fill,
 	.map = nv50_instobj_map,
 };
 
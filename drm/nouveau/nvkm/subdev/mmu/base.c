@@ -27,47 +27,163 @@
 #include <subdev/fb.h>
 
 void
-nvkm_vm_map_at(struct nvkm_vma *vma, u64 delta, struct nvkm_mem *node)
+nvkm_vm_flush(struct nvkm_vm *vm)
+{
+	vm->mmu->func->flush(vm);
+}
+
+static void
+nvkm_vm_unmap_run(struct nvkm_vma *vma, u32 type, u32 offset, u32 num)
 {
 	struct nvkm_vm *vm = vma->vm;
 	struct nvkm_mmu *mmu = vm->mmu;
-	struct nvkm_mm_node *r;
-	int big = vma->node->type != mmu->func->spg_shift;
-	u32 offset = vma->node->offset + (delta >> 12);
-	u32 bits = vma->node->type - 12;
+	int big = type != mmu->func->spg_shift;
+	u32 bits = type - 12;
 	u32 pde  = (offset >> mmu->func->pgt_bits) - vm->fpde;
 	u32 pte  = (offset & ((1 << mmu->func->pgt_bits) - 1)) >> bits;
 	u32 max  = 1 << (mmu->func->pgt_bits - bits);
 	u32 end, len;
 
-	delta = 0;
-	list_for_each_entry(r, &node->regions, rl_entry) {
-		u64 phys = (u64)r->offset << 12;
-		u32 num  = r->length >> bits;
+	while (num) {
+		struct nvkm_memory *pgt = vm->pgt[pde].mem[big];
 
-		while (num) {
-			struct nvkm_memory *pgt = vm->pgt[pde].mem[big];
+		end = (pte + num);
+		if (unlikely(end >= max))
+			end = max;
+		len = end - pte;
 
-			end = (pte + num);
-			if (unlikely(end >= max))
-				end = max;
-			len = end - pte;
+		mmu->func->unmap(vma, pgt, pte, len);
 
-			mmu->func->map(vma, pgt, node, pte, len, phys, delta);
+		num -= len;
+		pte += len;
+		if (unlikely(end >= max)) {
+			pde++;
+			pte = 0;
+		}
+	}
+}
 
-			num -= len;
-			pte += len;
-			if (unlikely(end >= max)) {
-				phys += len << (bits + 12);
-				pde++;
-				pte = 0;
+/* clears the big ptes of every big page the range touches, a mixed vma
+ * starts on a big page boundary, so none of them can belong to another vma
+ */
+static void
+nvkm_vm_unmap_lpg(struct nvkm_vma *vma, u64 delta, u64 length)
+{
+	u32 shift = vma->vm->mmu->lpg_shift;
+	u64 virt = ((u64)vma->node->offset << 12) + delta;
+	u64 head = virt >> shift;
+	u64 tail = (virt + length + (1ULL << shift) - 1) >> shift;
+
+	nvkm_vm_unmap_run(vma, shift, head << (shift - 12), tail - head);
+}
+
+static void
+nvkm_vm_unmap_at_(struct nvkm_vma *vma, u64 delta, u64 length)
+{
+	nvkm_vm_unmap_run(vma, vma->node->type,
+			  vma->node->offset + (delta >> 12),
+			  length >> vma->node->type);
+	if (vma->mixed)
+		nvkm_vm_unmap_lpg(vma, delta, length);
+}
+
+static void
+nvkm_vm_map_run(struct nvkm_vma *vma, u32 type, u32 offset, u32 num,
+		struct nvkm_mem *node, u64 phys, u64 delta)
+{
+	struct nvkm_vm *vm = vma->vm;
+	struct nvkm_mmu *mmu = vm->mmu;
+	int big = type != mmu->func->spg_shift;
+	u32 bits = type - 12;
+	u32 pde  = (offset >> mmu->func->pgt_bits) - vm->fpde;
+	u32 pte  = (offset & ((1 << mmu->func->pgt_bits) - 1)) >> bits;
+	u32 max  = 1 << (mmu->func->pgt_bits - bits);
+	u32 end, len;
+
+	while (num) {
+		struct nvkm_memory *pgt = vm->pgt[pde].mem[big];
+
+		end = (pte + num);
+		if (unlikely(end >= max))
+			end = max;
+		len = end - pte;
+
+		mmu->func->map(vma, pgt, node, pte, len, phys, delta, type);
+
+		num -= len;
+		pte += len;
+		if (unlikely(end >= max)) {
+			phys += len << (bits + 12);
+			pde++;
+			pte = 0;
+		}
+
+		delta += (u64)len << type;
+	}
+}
+
+static void
+nvkm_vm_map_at_(struct nvkm_vma *vma, u64 delta, struct nvkm_mem *node)
+{
+	struct nvkm_mmu *mmu = vma->vm->mmu;
+	const u64 mask = (1ULL << mmu->lpg_shift) - 1;
+	u32 offset = vma->node->offset + (delta >> 12);
+	u32 type = vma->node->type;
+	struct nvkm_mm_node *r;
+	u64 big = 0;
+
+	delta = 0;
+	list_for_each_entry(r, &node->regions, rl_entry) {
+		u64 phys = (u64)r->offset << 12;
+		u64 size = (u64)r->length << 12;
+
+		while (size) {
+			u64 virt = (u64)offset << 12;
+			u64 part = size;
+			u32 page = type;
+
+			/* with both page tables available, use big pages
+			 * wherever the region is big enough and both ends of
+			 * the mapping are aligned, and small pages up to the
+			 * next big page boundary otherwise
+			 */
+			if (vma->mixed && !((virt ^ phys) & mask)) {
+				u64 head = -virt & mask;
+				if (!head && size > mask) {
+					page = mmu->lpg_shift;
+					part = size & ~mask;
+				} else
+				if (head && head < size) {
+					part = head;
+				}
 			}
 
-			delta += (u64)len << vma->node->type;
+			nvkm_vm_map_run(vma, page, offset, part >> page, node,
+					phys, delta);
+			if (page != mmu->func->spg_shift)
+				big += part;
+
+			offset += part >> 12;
+			phys   += part;
+			delta  += part;
+			size   -= part;
 		}
 	}
 
-	mmu->func->flush(vm);
+	atomic64_add(delta, &mmu->mapped.total);
+	atomic64_add(big, &mmu->mapped.big);
+}
+
+void
+nvkm_vm_map_at(struct nvkm_vma *vma, u64 delta, struct nvkm_mem *node)
+{
+	/* clearing the big ptes would take neighbouring pages with them */
+	if (vma->mixed) {
+		WARN_ON(delta & ((1ULL << vma->vm->mmu->lpg_shift) - 1));
+		nvkm_vm_unmap_lpg(vma, delta, node->size << 12);
+	}
+	nvkm_vm_map_at_(vma, delta, node);
+	nvkm_vm_flush(vma->vm);
 }
 
 static void
@@ -83,49 +199,54 @@ nvkm_vm_map_sg_table(struct nvkm_vma *vma, u64 delta, u64 length,
 	u32 pde  = (offset >> mmu->func->pgt_bits) - vm->fpde;
 	u32 pte  = (offset & ((1 << mmu->func->pgt_bits) - 1)) >> bits;
 	u32 max  = 1 << (mmu->func->pgt_bits - bits);
-	unsigned m, sglen;
-	u32 end, len;
-	int i;
+	u64 page = 1ULL << vma->node->type;
 	struct scatterlist *sg;
+	dma_addr_t list[64];
+	u32 cnt = 0;
+	int i;
 
+	/* gather the pages of each dma range into runs, which are handed to
+	 * the backend whole, so it does one kmap() per run rather than per
+	 * page - runs are broken where the list fills or a pgt ends
+	 */
 	for_each_sg(mem->sg->sgl, sg, mem->sg->nents, i) {
-		struct nvkm_memory *pgt = vm->pgt[pde].mem[big];
-		sglen = sg_dma_len(sg) >> PAGE_SHIFT;
-
-		end = pte + sglen;
-		if (unlikely(end >= max))
-			end = max;
-		len = end - pte;
-
-		for (m = 0; m < len; m++) {
-			dma_addr_t addr = sg_dma_address(sg) + (m << PAGE_SHIFT);
+		dma_addr_t addr = sg_dma_address(sg);
+		u64 size = sg_dma_len(sg);
 
-			mmu->func->map_sg(vma, pgt, mem, pte, 1, &addr);
-			num--;
-			pte++;
+		/* a vma with big pages can be backed by system memory, so
+		 * long as every segment is aligned to the big page size
+		 */
+		if (WARN_ON((addr | size) & (page - 1)))
+			break;
 
-			if (num == 0)
-				goto finish;
-		}
-		if (unlikely(end >= max)) {
-			pde++;
-			pte = 0;
-		}
-		if (m < sglen) {
-			for (; m < sglen; m++) {
-				dma_addr_t addr = sg_dma_address(sg) + (m << PAGE_SHIFT);
-
-				mmu->func->map_sg(vma, pgt, mem, pte, 1, &addr);
-				num--;
-				pte++;
-				if (num == 0)
-					goto finish;
+		while (size && num) {
+			list[cnt++] = addr;
+			addr += page;
+			size -= page;
+			if (--num && cnt < ARRAY_SIZE(list) && pte + cnt < max)
+				continue;
+
+			mmu->func->map_sg(vma, vm->pgt[pde].mem[big], mem,
+					  pte, cnt, list);
+			pte += cnt;
+			cnt  = 0;
+			if (unlikely(pte >= max)) {
+				pde++;
+				pte = 0;
 			}
 		}
 
+		if (!num)
+			break;
 	}
-finish:
-	mmu->func->flush(vm);
+
+	if (cnt)
+		mmu->func->map_sg(vma, vm->pgt[pde].mem[big], mem,
+				  pte, cnt, list);
+
+	atomic64_add(length, &mmu->mapped.total);
+	if (big)
+		atomic64_add(length, &mmu->mapped.big);
 }
 
 static void
@@ -163,69 +284,165 @@ nvkm_vm_map_sg(struct nvkm_vma *vma, u64 delta, u64 length,
 		}
 	}
 
-	mmu->func->flush(vm);
+	atomic64_add(length, &mmu->mapped.total);
+	if (big)
+		atomic64_add(length, &mmu->mapped.big);
 }
 
 void
-nvkm_vm_map(struct nvkm_vma *vma, struct nvkm_mem *node)
+nvkm_vm_map_defer(struct nvkm_vma *vma, struct nvkm_mem *node)
 {
+	/* big ptes left from a previous mapping would hide the new one */
+	if (vma->mixed)
+		nvkm_vm_unmap_lpg(vma, 0, node->size << 12);
+
 	if (node->sg)
 		nvkm_vm_map_sg_table(vma, 0, node->size << 12, node);
 	else
 	if (node->pages)
 		nvkm_vm_map_sg(vma, 0, node->size << 12, node);
 	else
-		nvkm_vm_map_at(vma, 0, node);
+		nvkm_vm_map_at_(vma, 0, node);
+}
+
+void
+nvkm_vm_map(struct nvkm_vma *vma, struct nvkm_mem *node)
+{
+	nvkm_vm_map_defer(vma, node);
+	nvkm_vm_flush(vma->vm);
 }
 
 void
 nvkm_vm_unmap_at(struct nvkm_vma *vma, u64 delta, u64 length)
 {
-	struct nvkm_vm *vm = vma->vm;
+	nvkm_vm_unmap_at_(vma, delta, length);
+	nvkm_vm_flush(vma->vm);
+}
+
+void
+nvkm_vm_unmap_defer(struct nvkm_vma *vma)
+{
+	nvkm_vm_unmap_at_(vma, 0, (u64)vma->node->length << 12);
+}
+
+void
+nvkm_vm_unmap(struct nvkm_vma *vma)
+{
+	nvkm_vm_unmap_defer(vma);
+	nvkm_vm_flush(vma->vm);
+}
+
+static int
+nvkm_mmu_pool_get(struct nvkm_mmu *mmu, int big, u32 size,
+		  struct nvkm_memory **ppgt)
+{
+	mutex_lock(&mmu->pool.mutex);
+	if (mmu->pool.nr[big]) {
+		*ppgt = mmu->pool.mem[big][--mmu->pool.nr[big]];
+		mmu->pool.hit++;
+		mutex_unlock(&mmu->pool.mutex);
+		return 0;
+	}
+	mmu->pool.miss++;
+	mutex_unlock(&mmu->pool.mutex);
+
+	return nvkm_memory_new(mmu->subdev.device, NVKM_MEM_TARGET_INST,
+			       size, 0x1000, true, ppgt);
+}
+
+static void
+nvkm_mmu_pool_put(struct nvkm_mmu *mmu, int big, struct nvkm_memory *pgt)
+{
+	bool keep;
+
+	mutex_lock(&mmu->pool.mutex);
+	keep = mmu->pool.nr[big] < ARRAY_SIZE(mmu->pool.mem[big]);
+	mutex_unlock(&mmu->pool.mutex);
+
+	if (keep) {
+		nvkm_kmap(pgt);
+		nvkm_fo32(pgt, 0, 0x00000000, nvkm_memory_size(pgt));
+		nvkm_done(pgt);
+
+		mutex_lock(&mmu->pool.mutex);
+		if (mmu->pool.nr[big] < ARRAY_SIZE(mmu->pool.mem[big])) {
+			mmu->pool.mem[big][mmu->pool.nr[big]++] = pgt;
+			pgt = NULL;
+		}
+		mutex_unlock(&mmu->pool.mutex);
+	}
+
+	nvkm_memory_del(&pgt);
+}
+
+static void
+nvkm_vm_release_pgt(struct nvkm_vm *vm, u32 pde, int big)
+{
 	struct nvkm_mmu *mmu = vm->mmu;
-	int big = vma->node->type != mmu->func->spg_shift;
-	u32 offset = vma->node->offset + (delta >> 12);
-	u32 bits = vma->node->type - 12;
-	u32 num  = length >> vma->node->type;
-	u32 pde  = (offset >> mmu->func->pgt_bits) - vm->fpde;
-	u32 pte  = (offset & ((1 << mmu->func->pgt_bits) - 1)) >> bits;
-	u32 max  = 1 << (mmu->func->pgt_bits - bits);
-	u32 end, len;
+	struct nvkm_vm_pgt *vpgt = &vm->pgt[pde - vm->fpde];
+	struct nvkm_memory *pgt = vpgt->mem[big];
+	struct nvkm_vm_pgd *vpgd;
 
-	while (num) {
-		struct nvkm_memory *pgt = vm->pgt[pde].mem[big];
+	vpgt->mem[big] = NULL;
 
-		end = (pte + num);
-		if (unlikely(end >= max))
-			end = max;
-		len = end - pte;
+	list_for_each_entry(vpgd, &vm->pgd_list, head) {
+		mmu->func->map_pgt(vpgd->obj, pde, vpgt->mem);
+	}
 
-		mmu->func->unmap(vma, pgt, pte, len);
+	nvkm_mmu_pool_put(mmu, big, pgt);
+}
 
-		num -= len;
-		pte += len;
-		if (unlikely(end >= max)) {
-			pde++;
-			pte = 0;
+#define NVKM_VM_IDLE_GRACE msecs_to_jiffies(1000)
+
+static bool
+nvkm_vm_idle_del(struct nvkm_vm *vm, u32 pde, int big)
+{
+	int i;
+
+	for (i = 0; i < vm->idle_nr; i++) {
+		if (vm->idle[i].pde == pde && vm->idle[i].big == big) {
+			memmove(&vm->idle[i], &vm->idle[i + 1],
+				(--vm->idle_nr - i) * sizeof(vm->idle[0]));
+			return true;
 		}
 	}
 
-	mmu->func->flush(vm);
+	return false;
 }
 
-void
-nvkm_vm_unmap(struct nvkm_vma *vma)
+static void
+nvkm_vm_idle_reap(struct nvkm_vm *vm, bool all)
 {
-	nvkm_vm_unmap_at(vma, 0, (u64)vma->node->length << 12);
+	while (vm->idle_nr) {
+		struct nvkm_vm_idle idle = vm->idle[0];
+		if (!all && time_before(jiffies, idle.time + NVKM_VM_IDLE_GRACE))
+			break;
+		nvkm_vm_idle_del(vm, idle.pde, idle.big);
+		nvkm_vm_release_pgt(vm, idle.pde, idle.big);
+	}
+}
+
+static void
+nvkm_vm_idle_add(struct nvkm_vm *vm, u32 pde, int big)
+{
+	struct nvkm_vm_idle *idle;
+
+	if (vm->idle_nr == ARRAY_SIZE(vm->idle)) {
+		struct nvkm_vm_idle oldest = vm->idle[0];
+		nvkm_vm_idle_del(vm, oldest.pde, oldest.big);
+		nvkm_vm_release_pgt(vm, oldest.pde, oldest.big);
+	}
+
+	idle = &vm->idle[vm->idle_nr++];
+	idle->pde = pde;
+	idle->big = big;
+	idle->time = jiffies;
 }
 
 static void
 nvkm_vm_unmap_pgt(struct nvkm_vm *vm, int big, u32 fpde, u32 lpde)
 {
-	struct nvkm_mmu *mmu = vm->mmu;
-	struct nvkm_vm_pgd *vpgd;
 	struct nvkm_vm_pgt *vpgt;
-	struct nvkm_memory *pgt;
 	u32 pde;
 
 	for (pde = fpde; pde <= lpde; pde++) {
@@ -233,15 +450,10 @@ nvkm_vm_unmap_pgt(struct nvkm_vm *vm, int big, u32 fpde, u32 lpde)
 		if (--vpgt->refcount[big])
 			continue;
 
-		pgt = vpgt->mem[big];
-		vpgt->mem[big] = NULL;
-
-		list_for_each_entry(vpgd, &vm->pgd_list, head) {
-			mmu->func->map_pgt(vpgd->obj, pde, vpgt->mem);
-		}
-
-		nvkm_memory_del(&pgt);
+		nvkm_vm_idle_add(vm, pde, big);
 	}
+
+	nvkm_vm_idle_reap(vm, false);
 }
 
 static int
@@ -254,11 +466,25 @@ nvkm_vm_map_pgt(struct nvkm_vm *vm, u32 pde, u32 type)
 	u32 pgt_size;
 	int ret;
 
+	/* the page table is still in place from a previous user */
+	if (nvkm_vm_idle_del(vm, pde, big)) {
+		mutex_lock(&mmu->pool.mutex);
+		mmu->pool.grace++;
+		mutex_unlock(&mmu->pool.mutex);
+		vpgt->refcount[big]++;
+		return 0;
+	}
+
+	/* an idle page table of the other size goes now, unless the pde
+	 * can point at both of them
+	 */
+	if (!mmu->func->dual_pgt && nvkm_vm_idle_del(vm, pde, !big))
+		nvkm_vm_release_pgt(vm, pde, !big);
+
 	pgt_size  = (1 << (mmu->func->pgt_bits + 12)) >> type;
 	pgt_size *= 8;
 
-	ret = nvkm_memory_new(mmu->subdev.device, NVKM_MEM_TARGET_INST,
-			      pgt_size, 0x1000, true, &vpgt->mem[big]);
+	ret = nvkm_mmu_pool_get(mmu, big, pgt_size, &vpgt->mem[big]);
 	if (unlikely(ret))
 		return ret;
 
@@ -270,17 +496,57 @@ nvkm_vm_map_pgt(struct nvkm_vm *vm, u32 pde, u32 type)
 	return 0;
 }
 
+static int
+nvkm_vm_ref_pgt(struct nvkm_vm *vm, u32 type, u32 fpde, u32 lpde)
+{
+	struct nvkm_mmu *mmu = vm->mmu;
+	int big = (type != mmu->func->spg_shift);
+	u32 pde;
+	int ret;
+
+	for (pde = fpde; pde <= lpde; pde++) {
+		struct nvkm_vm_pgt *vpgt = &vm->pgt[pde - vm->fpde];
+
+		if (likely(vpgt->refcount[big])) {
+			vpgt->refcount[big]++;
+			continue;
+		}
+
+		ret = nvkm_vm_map_pgt(vm, pde, type);
+		if (ret) {
+			if (pde != fpde)
+				nvkm_vm_unmap_pgt(vm, big, fpde, pde - 1);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
 int
 nvkm_vm_get(struct nvkm_vm *vm, u64 size, u32 page_shift, u32 access,
 	    struct nvkm_vma *vma)
 {
 	struct nvkm_mmu *mmu = vm->mmu;
-	u32 align = (1 << page_shift) >> 12;
+	bool mixed = false;
 	u32 msize = size >> 12;
-	u32 fpde, lpde, pde;
+	u32 fpde, lpde, align;
 	int ret;
 
+	/* small pages, plus a reference on the big page tables so that
+	 * nvkm_vm_map() can use big pages where the memory allows - a
+	 * pde must be able to point at both page tables at once for that
+	 */
+	if (page_shift == NVKM_VM_PAGE_AUTO) {
+		page_shift = mmu->func->spg_shift;
+		mixed = mmu->func->dual_pgt &&
+			mmu->lpg_shift != mmu->func->spg_shift;
+	}
+
+	align = (1 << (mixed ? mmu->lpg_shift : page_shift)) >> 12;
+
 	mutex_lock(&vm->mutex);
+	nvkm_vm_idle_reap(vm, false);
 	ret = nvkm_mm_head(&vm->mm, 0, page_shift, msize, msize, align,
 			   &vma->node);
 	if (unlikely(ret != 0)) {
@@ -291,23 +557,17 @@ nvkm_vm_get(struct nvkm_vm *vm, u64 size, u32 page_shift, u32 access,
 	fpde = (vma->node->offset >> mmu->func->pgt_bits);
 	lpde = (vma->node->offset + vma->node->length - 1) >> mmu->func->pgt_bits;
 
-	for (pde = fpde; pde <= lpde; pde++) {
-		struct nvkm_vm_pgt *vpgt = &vm->pgt[pde - vm->fpde];
-		int big = (vma->node->type != mmu->func->spg_shift);
-
-		if (likely(vpgt->refcount[big])) {
-			vpgt->refcount[big]++;
-			continue;
-		}
+	ret = nvkm_vm_ref_pgt(vm, page_shift, fpde, lpde);
+	if (ret == 0 && mixed) {
+		ret = nvkm_vm_ref_pgt(vm, mmu->lpg_shift, fpde, lpde);
+		if (ret)
+			nvkm_vm_unmap_pgt(vm, 0, fpde, lpde);
+	}
 
-		ret = nvkm_vm_map_pgt(vm, pde, vma->node->type);
-		if (ret) {
-			if (pde != fpde)
-				nvkm_vm_unmap_pgt(vm, big, fpde, pde - 1);
-			nvkm_mm_free(&vm->mm, &vma->node);
-			mutex_unlock(&vm->mutex);
-			return ret;
-		}
+	if (ret) {
+		nvkm_mm_free(&vm->mm, &vma->node);
+		mutex_unlock(&vm->mutex);
+		return ret;
 	}
 	mutex_unlock(&vm->mutex);
 
@@ -315,6 +575,7 @@ nvkm_vm_get(struct nvkm_vm *vm, u64 size, u32 page_shift, u32 access,
 	nvkm_vm_ref(vm, &vma->vm, NULL);
 	vma->offset = (u64)vma->node->offset << 12;
 	vma->access = access;
+	vma->mixed = mixed;
 	return 0;
 }
 
@@ -335,6 +596,8 @@ nvkm_vm_put(struct nvkm_vma *vma)
 
 	mutex_lock(&vm->mutex);
 	nvkm_vm_unmap_pgt(vm, vma->node->type != mmu->func->spg_shift, fpde, lpde);
+	if (vma->mixed)
+		nvkm_vm_unmap_pgt(vm, 1, fpde, lpde);
 	nvkm_mm_free(&vm->mm, &vma->node);
 	mutex_unlock(&vm->mutex);
 
@@ -461,6 +724,7 @@ nvkm_vm_del(struct kref *kref)
 		nvkm_vm_unlink(vm, vpgd->obj);
 	}
 
+	nvkm_vm_idle_reap(vm, true);
 	nvkm_mm_fini(&vm->mm);
 	vfree(vm->pgt);
 	kfree(vm);
@@ -504,10 +768,38 @@ nvkm_mmu_init(struct nvkm_subdev *subdev)
 	return 0;
 }
 
+static void
+nvkm_mmu_pool_fini(struct nvkm_mmu *mmu)
+{
+	int big;
+
+	mutex_lock(&mmu->pool.mutex);
+	for (big = 0; big < ARRAY_SIZE(mmu->pool.nr); big++) {
+		while (mmu->pool.nr[big])
+			nvkm_memory_del(&mmu->pool.mem[big][--mmu->pool.nr[big]]);
+	}
+	mutex_unlock(&mmu->pool.mutex);
+}
+
+static int
+nvkm_mmu_fini(struct nvkm_subdev *subdev, bool suspend)
+{
+	struct nvkm_mmu *mmu = nvkm_mmu(subdev);
+	nvkm_debug(subdev, "pgt pool: %lld hit, %lld miss, %lld grace\n",
+		   mmu->pool.hit, mmu->pool.miss, mmu->pool.grace);
+	nvkm_debug(subdev, "mapped: %lld bytes, %lld with big pages\n",
+		   atomic64_read(&mmu->mapped.total),
+		   atomic64_read(&mmu->mapped.big));
+	nvkm_mmu_pool_fini(mmu);
+	return 0;
+}
+
 static void *
 nvkm_mmu_dtor(struct nvkm_subdev *subdev)
 {
 	struct nvkm_mmu *mmu = nvkm_mmu(subdev);
+	/* vms that outlive fini (the bar's) may have refilled the pool */
+	nvkm_mmu_pool_fini(mmu);
 	if (mmu->func->dtor)
 		return mmu->func->dtor(mmu);
 	return mmu;
@@ -518,6 +810,7 @@ nvkm_mmu = {
 	.dtor = nvkm_mmu_dtor,
 	.oneinit = nvkm_mmu_oneinit,
 	.init = nvkm_mmu_init,
+	.fini = nvkm_mmu_fini,
 };
 
 void
@@ -529,6 +822,7 @@ nvkm_mmu_ctor(const struct nvkm_mmu_func *func, struct nvkm_device *device,
 	mmu->limit = func->limit;
 	mmu->dma_bits = func->dma_bits;
 	mmu->lpg_shift = func->lpg_shift;
+	mutex_init(&mmu->pool.mutex);
 }
 
 int
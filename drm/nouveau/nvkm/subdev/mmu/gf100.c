@@ -101,12 +101,13 @@ gf100_vm_addr(struct nvkm_vma *vma, u64 phys, u32 memtype, u32 target)
 
 static void
 gf100_vm_map(struct nvkm_vma *vma, struct nvkm_memory *pgt,
-	     struct nvkm_mem *mem, u32 pte, u32 cnt, u64 phys, u64 delta)
+	     struct nvkm_mem *mem, u32 pte, u32 cnt, u64 phys, u64 delta,
+	     u32 type)
 {
-	u64 next = 1 << (vma->node->type - 8);
+	struct nvkm_mmu_ptes ptes;
+	u64 next = 1 << (type - 8);
 
 	phys  = gf100_vm_addr(vma, phys, mem->memtype, 0);
-	pte <<= 3;
 
 	if (mem->tag) {
 		struct nvkm_ltc *ltc = vma->vm->mmu->subdev.device->ltc;
@@ -117,12 +118,12 @@ gf100_vm_map(struct nvkm_vma *vma, struct nvkm_memory *pgt,
 	}
 
 	nvkm_kmap(pgt);
+	nvkm_mmu_ptes_init(&ptes, pgt, pte << 3);
 	while (cnt--) {
-		nvkm_wo32(pgt, pte + 0, lower_32_bits(phys));
-		nvkm_wo32(pgt, pte + 4, upper_32_bits(phys));
+		nvkm_mmu_ptes_wr64(&ptes, phys);
 		phys += next;
-		pte  += 8;
 	}
+	nvkm_mmu_ptes_done(&ptes);
 	nvkm_done(pgt);
 }
 
@@ -133,15 +134,15 @@ gf100_vm_map_sg(struct nvkm_vma *vma, struct nvkm_memory *pgt,
 	u32 target = (vma->access & NV_MEM_ACCESS_NOSNOOP) ? 7 : 5;
 	/* compressed storage types are invalid for system memory */
 	u32 memtype = gf100_pte_storage_type_map[mem->memtype & 0xff];
+	struct nvkm_mmu_ptes ptes;
 
 	nvkm_kmap(pgt);
-	pte <<= 3;
+	nvkm_mmu_ptes_init(&ptes, pgt, pte << 3);
 	while (cnt--) {
 		u64 phys = gf100_vm_addr(vma, *list++, memtype, target);
-		nvkm_wo32(pgt, pte + 0, lower_32_bits(phys));
-		nvkm_wo32(pgt, pte + 4, upper_32_bits(phys));
-		pte += 8;
+		nvkm_mmu_ptes_wr64(&ptes, phys);
 	}
+	nvkm_mmu_ptes_done(&ptes);
 	nvkm_done(pgt);
 }
 
@@ -150,11 +151,7 @@ gf100_vm_unmap(struct nvkm_vma *vma, struct nvkm_memory *pgt, u32 pte, u32 cnt)
 {
 	nvkm_kmap(pgt);
 	pte <<= 3;
-	while (cnt--) {
-		nvkm_wo32(pgt, pte + 0, 0x00000000);
-		nvkm_wo32(pgt, pte + 4, 0x00000000);
-		pte += 8;
-	}
+	nvkm_fo32(pgt, pte, 0x00000000, cnt * 8);
 	nvkm_done(pgt);
 }
 
@@ -206,6 +203,7 @@ gf100_mmu = {
 	.pgt_bits  = 27 - 12,
 	.spg_shift = 12,
 	.lpg_shift = 17,
+	.dual_pgt  = true,
 	.create = gf100_vm_create,
 	.map_pgt = gf100_vm_map_pgt,
 	.map = gf100_vm_map,
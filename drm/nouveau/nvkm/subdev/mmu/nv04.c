@@ -36,18 +36,20 @@ static void
 nv04_vm_map_sg(struct nvkm_vma *vma, struct nvkm_memory *pgt,
 	       struct nvkm_mem *mem, u32 pte, u32 cnt, dma_addr_t *list)
 {
-	pte = 0x00008 + (pte * 4);
+	struct nvkm_mmu_ptes ptes;
+
 	nvkm_kmap(pgt);
+	nvkm_mmu_ptes_init(&ptes, pgt, 0x00008 + (pte * 4));
 	while (cnt) {
 		u32 page = PAGE_SIZE / NV04_PDMA_PAGE;
 		u32 phys = (u32)*list++;
 		while (cnt && page--) {
-			nvkm_wo32(pgt, pte, phys | 3);
+			nvkm_mmu_ptes_wr32(&ptes, phys | 3);
 			phys += NV04_PDMA_PAGE;
-			pte += 4;
 			cnt -= 1;
 		}
 	}
+	nvkm_mmu_ptes_done(&ptes);
 	nvkm_done(pgt);
 }
 
@@ -56,10 +58,7 @@ nv04_vm_unmap(struct nvkm_vma *vma, struct nvkm_memory *pgt, u32 pte, u32 cnt)
 {
 	pte = 0x00008 + (pte * 4);
 	nvkm_kmap(pgt);
-	while (cnt--) {
-		nvkm_wo32(pgt, pte, 0x00000000);
-		pte += 4;
-	}
+	nvkm_fo32(pgt, pte, 0x00000000, cnt * 4);
 	nvkm_done(pgt);
 }
 
@@ -38,18 +38,20 @@ static void
 nv41_vm_map_sg(struct nvkm_vma *vma, struct nvkm_memory *pgt,
 	       struct nvkm_mem *mem, u32 pte, u32 cnt, dma_addr_t *list)
 {
-	pte = pte * 4;
+	struct nvkm_mmu_ptes ptes;
+
 	nvkm_kmap(pgt);
+	nvkm_mmu_ptes_init(&ptes, pgt, pte * 4);
 	while (cnt) {
 		u32 page = PAGE_SIZE / NV41_GART_PAGE;
 		u64 phys = (u64)*list++;
 		while (cnt && page--) {
-			nvkm_wo32(pgt, pte, (phys >> 7) | 1);
+			nvkm_mmu_ptes_wr32(&ptes, (phys >> 7) | 1);
 			phys += NV41_GART_PAGE;
-			pte += 4;
 			cnt -= 1;
 		}
 	}
+	nvkm_mmu_ptes_done(&ptes);
 	nvkm_done(pgt);
 }
 
@@ -58,10 +60,7 @@ nv41_vm_unmap(struct nvkm_vma *vma, struct nvkm_memory *pgt, u32 pte, u32 cnt)
 {
 	pte = pte * 4;
 	nvkm_kmap(pgt);
-	while (cnt--) {
-		nvkm_wo32(pgt, pte, 0x00000000);
-		pte += 4;
-	}
+	nvkm_fo32(pgt, pte, 0x00000000, cnt * 4);
 	nvkm_done(pgt);
 }
 
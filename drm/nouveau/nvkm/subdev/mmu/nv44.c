@@ -85,6 +85,7 @@ nv44_vm_map_sg(struct nvkm_vma *vma, struct nvkm_memory *pgt,
 	       struct nvkm_mem *mem, u32 pte, u32 cnt, dma_addr_t *list)
 {
 	struct nv04_mmu *mmu = nv04_mmu(vma->vm->mmu);
+	struct nvkm_mmu_ptes ptes;
 	u32 tmp[4];
 	int i;
 
@@ -98,15 +99,18 @@ nv44_vm_map_sg(struct nvkm_vma *vma, struct nvkm_memory *pgt,
 		cnt  -= part;
 	}
 
+	nvkm_mmu_ptes_init(&ptes, pgt, pte * 4);
 	while (cnt >= 4) {
 		for (i = 0; i < 4; i++)
 			tmp[i] = *list++ >> 12;
-		nvkm_wo32(pgt, pte++ * 4, tmp[0] >>  0 | tmp[1] << 27);
-		nvkm_wo32(pgt, pte++ * 4, tmp[1] >>  5 | tmp[2] << 22);
-		nvkm_wo32(pgt, pte++ * 4, tmp[2] >> 10 | tmp[3] << 17);
-		nvkm_wo32(pgt, pte++ * 4, tmp[3] >> 15 | 0x40000000);
+		nvkm_mmu_ptes_wr32(&ptes, tmp[0] >>  0 | tmp[1] << 27);
+		nvkm_mmu_ptes_wr32(&ptes, tmp[1] >>  5 | tmp[2] << 22);
+		nvkm_mmu_ptes_wr32(&ptes, tmp[2] >> 10 | tmp[3] << 17);
+		nvkm_mmu_ptes_wr32(&ptes, tmp[3] >> 15 | 0x40000000);
+		pte += 4;
 		cnt -= 4;
 	}
+	nvkm_mmu_ptes_done(&ptes);
 
 	if (cnt)
 		nv44_vm_fill(pgt, mmu->null, list, pte, cnt);
@@ -127,12 +131,10 @@ nv44_vm_unmap(struct nvkm_vma *vma, struct nvkm_memory *pgt, u32 pte, u32 cnt)
 		cnt  -= part;
 	}
 
-	while (cnt >= 4) {
-		nvkm_wo32(pgt, pte++ * 4, 0x00000000);
-		nvkm_wo32(pgt, pte++ * 4, 0x00000000);
-		nvkm_wo32(pgt, pte++ * 4, 0x00000000);
-		nvkm_wo32(pgt, pte++ * 4, 0x00000000);
-		cnt -= 4;
+	if (cnt >= 4) {
+		nvkm_fo32(pgt, pte * 4, 0x00000000, (cnt & ~3) * 4);
+		pte += cnt & ~3;
+		cnt &= 3;
 	}
 
 	if (cnt)
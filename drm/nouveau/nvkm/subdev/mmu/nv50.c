@@ -75,10 +75,12 @@ vm_addr(struct nvkm_vma *vma, u64 phys, u32 memtype, u32 target)
 
 static void
 nv50_vm_map(struct nvkm_vma *vma, struct nvkm_memory *pgt,
-	    struct nvkm_mem *mem, u32 pte, u32 cnt, u64 phys, u64 delta)
+	    struct nvkm_mem *mem, u32 pte, u32 cnt, u64 phys, u64 delta,
+	    u32 type)
 {
 	struct nvkm_ram *ram = vma->vm->mmu->subdev.device->fb->ram;
 	u32 comp = (mem->memtype & 0x180) >> 7;
+	struct nvkm_mmu_ptes ptes;
 	u32 block, target;
 	int i;
 
@@ -94,6 +96,7 @@ nv50_vm_map(struct nvkm_vma *vma, struct nvkm_memory *pgt,
 	cnt <<= 3;
 
 	nvkm_kmap(pgt);
+	nvkm_mmu_ptes_init(&ptes, pgt, pte);
 	while (cnt) {
 		u32 offset_h = upper_32_bits(phys);
 		u32 offset_l = lower_32_bits(phys);
@@ -105,21 +108,22 @@ nv50_vm_map(struct nvkm_vma *vma, struct nvkm_memory *pgt,
 		}
 		offset_l |= (i << 7);
 
-		phys += block << (vma->node->type - 3);
+		phys += block << (type - 3);
 		cnt  -= block;
 		if (comp) {
 			u32 tag = mem->tag->offset + ((delta >> 16) * comp);
 			offset_h |= (tag << 17);
-			delta    += block << (vma->node->type - 3);
+			delta    += block << (type - 3);
 		}
 
+		pte += block;
 		while (block) {
-			nvkm_wo32(pgt, pte + 0, offset_l);
-			nvkm_wo32(pgt, pte + 4, offset_h);
-			pte += 8;
+			nvkm_mmu_ptes_wr32(&ptes, offset_l);
+			nvkm_mmu_ptes_wr32(&ptes, offset_h);
 			block -= 8;
 		}
 	}
+	nvkm_mmu_ptes_done(&ptes);
 	nvkm_done(pgt);
 }
 
@@ -128,14 +132,15 @@ nv50_vm_map_sg(struct nvkm_vma *vma, struct nvkm_memory *pgt,
 	       struct nvkm_mem *mem, u32 pte, u32 cnt, dma_addr_t *list)
 {
 	u32 target = (vma->access & NV_MEM_ACCESS_NOSNOOP) ? 3 : 2;
-	pte <<= 3;
+	struct nvkm_mmu_ptes ptes;
+
 	nvkm_kmap(pgt);
+	nvkm_mmu_ptes_init(&ptes, pgt, pte << 3);
 	while (cnt--) {
 		u64 phys = vm_addr(vma, (u64)*list++, mem->memtype, target);
-		nvkm_wo32(pgt, pte + 0, lower_32_bits(phys));
-		nvkm_wo32(pgt, pte + 4, upper_32_bits(phys));
-		pte += 8;
+		nvkm_mmu_ptes_wr64(&ptes, phys);
 	}
+	nvkm_mmu_ptes_done(&ptes);
 	nvkm_done(pgt);
 }
 
@@ -144,11 +149,7 @@ nv50_vm_unmap(struct nvkm_vma *vma, struct nvkm_memory *pgt, u32 pte, u32 cnt)
 {
 	pte <<= 3;
 	nvkm_kmap(pgt);
-	while (cnt--) {
-		nvkm_wo32(pgt, pte + 0, 0x00000000);
-		nvkm_wo32(pgt, pte + 4, 0x00000000);
-		pte += 8;
-	}
+	nvkm_fo32(pgt, pte, 0x00000000, cnt * 8);
 	nvkm_done(pgt);
 }
 
@@ -2,6 +2,7 @@
 #define __NVKM_MMU_PRIV_H__
 #define nvkm_mmu(p) container_of((p), struct nvkm_mmu, subdev)
 #include <subdev/mmu.h>
+#include <core/memory.h>
 
 void nvkm_mmu_ctor(const struct nvkm_mmu_func *, struct nvkm_device *,
 		   int index, struct nvkm_mmu *);
@@ -18,6 +19,7 @@ struct nvkm_mmu_func {
 	u32 pgt_bits;
 	u8  spg_shift;
 	u8  lpg_shift;
+	bool dual_pgt; /* a pde can point at small and big page tables */
 
 	int  (*create)(struct nvkm_mmu *, u64 offset, u64 length, u64 mm_offset,
 		       struct lock_class_key *, struct nvkm_vm **);
@@ -26,7 +28,7 @@ struct nvkm_mmu_func {
 			struct nvkm_memory *pgt[2]);
 	void (*map)(struct nvkm_vma *, struct nvkm_memory *,
 		    struct nvkm_mem *, u32 pte, u32 cnt,
-		    u64 phys, u64 delta);
+		    u64 phys, u64 delta, u32 type);
 	void (*map_sg)(struct nvkm_vma *, struct nvkm_memory *,
 		       struct nvkm_mem *, u32 pte, u32 cnt, dma_addr_t *);
 	void (*unmap)(struct nvkm_vma *, struct nvkm_memory *pgt,
@@ -34,6 +36,56 @@ struct nvkm_mmu_func {
 	void (*flush)(struct nvkm_vm *);
 };
 
+/* PTE batching - map callbacks build runs of PTEs in a host staging buffer,
+ * which is pushed into the page table with a single span write whenever it
+ * fills up, rather than going through the 32-bit accessors for each word
+ *
+ * page tables that lack a span accessor still get word writes, from the
+ * fallback in nvkm_wo()
+ */
+struct nvkm_mmu_ptes {
+	struct nvkm_memory *pgt;
+	u32 addr;
+	u32 size;
+	u32 data[128];
+};
+
+static inline void
+nvkm_mmu_ptes_init(struct nvkm_mmu_ptes *ptes, struct nvkm_memory *pgt,
+		   u32 addr)
+{
+	ptes->pgt  = pgt;
+	ptes->addr = addr;
+	ptes->size = 0;
+}
+
+static inline void
+nvkm_mmu_ptes_done(struct nvkm_mmu_ptes *ptes)
+{
+	if (ptes->size) {
+		nvkm_wo(ptes->pgt, ptes->addr, ptes->data, ptes->size);
+		ptes->addr += ptes->size;
+		ptes->size  = 0;
+	}
+}
+
+static inline void
+nvkm_mmu_ptes_wr32(struct nvkm_mmu_ptes *ptes, u32 data)
+{
+	ptes->data[ptes->size / 4] = data;
+	if ((ptes->size += 4) == sizeof(ptes->data))
+		nvkm_mmu_ptes_done(ptes);
+}
+
+static inline void
+nvkm_mmu_ptes_wr64(struct nvkm_mmu_ptes *ptes, u64 data)
+{
+	ptes->data[ptes->size / 4 + 0] = lower_32_bits(data);
+	ptes->data[ptes->size / 4 + 1] = upper_32_bits(data);
+	if ((ptes->size += 8) == sizeof(ptes->data))
+		nvkm_mmu_ptes_done(ptes);
+}
+
 int nvkm_vm_create(struct nvkm_mmu *, u64, u64, u64, u32,
 		   struct lock_class_key *, struct nvkm_vm **);
 #endif
@@ -23,29 +23,126 @@
  */
 #include <nvif/os.h>
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* firmware images are mapped read-only and shared by every request for the
+ * same file, they stay cached after their last release so resume, or the
+ * probe of another device, doesn't need to load them again
+ *
+ * NVOS_FW_STATS in the environment dumps hit/miss counts, and the time spent
+ * in request_firmware(), at exit
+ */
+struct nvos_firmware {
+	struct firmware fw;
+	struct list_head head;
+	int refs;
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	struct timespec mtime;
+	char path[];
+};
+
+static DEFINE_MUTEX(nvos_firmware_mutex);
+static LIST_HEAD(nvos_firmware_list);
+static struct {
+	u64 hits;
+	u64 misses;
+	s64 hit_ns;
+	s64 miss_ns;
+} nvos_firmware_stats;
+
+static void
+nvos_firmware_del(struct nvos_firmware *fw)
+{
+	list_del(&fw->head);
+	if (fw->fw.data)
+		munmap(fw->fw.data, fw->fw.size);
+	free(fw);
+}
+
 static int
 request_firmware_(const struct firmware **pfw, const char *prefix,
 		  const char *name, struct device *dev)
 {
-	struct firmware *fw = *(void **)pfw = malloc(sizeof(*fw));
+	struct nvos_firmware *fw, *temp;
+	s64 time = ktime_to_ns(ktime_get());
+	struct stat st;
+	bool hit = false;
 	char *path;
-	int fd;
+	int fd, ret;
 
 	if (!(path = malloc(strlen(prefix) + strlen(name) + 1)))
 		return -ENOMEM;
 	sprintf(path, "%s%s", prefix, name);
 
 	fd = open(path, O_RDONLY);
-	free(path);
-	if (fd >= 0) {
-		off_t len = lseek(fd, 0, SEEK_END);
-		fw->data = malloc(len);
-		fw->size = pread(fd, fw->data, len, 0);
-		return 0;
+	if (fd < 0 || fstat(fd, &st)) {
+		ret = -EINVAL;
+		goto done;
 	}
 
-	free(fw);
-	return -EINVAL;
+	mutex_lock(&nvos_firmware_mutex);
+	list_for_each_entry_safe(fw, temp, &nvos_firmware_list, head) {
+		if (fw->dev == st.st_dev && fw->ino == st.st_ino &&
+		    fw->size == st.st_size &&
+		    fw->mtime.tv_sec == st.st_mtim.tv_sec &&
+		    fw->mtime.tv_nsec == st.st_mtim.tv_nsec) {
+			hit = true;
+			break;
+		}
+
+		/* file has changed since it was cached */
+		if (!fw->refs && !strcmp(fw->path, path))
+			nvos_firmware_del(fw);
+	}
+
+	if (!hit) {
+		if (!(fw = calloc(1, sizeof(*fw) + strlen(path) + 1))) {
+			mutex_unlock(&nvos_firmware_mutex);
+			ret = -ENOMEM;
+			goto done;
+		}
+
+		if (st.st_size) {
+			fw->fw.data = mmap(NULL, st.st_size, PROT_READ,
+					   MAP_PRIVATE, fd, 0);
+			if (fw->fw.data == MAP_FAILED) {
+				mutex_unlock(&nvos_firmware_mutex);
+				free(fw);
+				ret = -errno;
+				goto done;
+			}
+		}
+
+		fw->fw.size = st.st_size;
+		fw->dev = st.st_dev;
+		fw->ino = st.st_ino;
+		fw->size = st.st_size;
+		fw->mtime = st.st_mtim;
+		strcpy(fw->path, path);
+		list_add(&fw->head, &nvos_firmware_list);
+	}
+
+	fw->refs++;
+	*pfw = &fw->fw;
+
+	time = ktime_to_ns(ktime_get()) - time;
+	if (hit) {
+		nvos_firmware_stats.hits++;
+		nvos_firmware_stats.hit_ns += time;
+	} else {
+		nvos_firmware_stats.misses++;
+		nvos_firmware_stats.miss_ns += time;
+	}
+	mutex_unlock(&nvos_firmware_mutex);
+	ret = 0;
+done:
+	if (fd >= 0)
+		close(fd);
+	free(path);
+	return ret;
 }
 
 int
@@ -62,6 +159,27 @@ request_firmware(const struct firmware **pfw, const char *name,
 void
 release_firmware(const struct firmware *fw)
 {
-	free(fw->data);
-	free((void *)fw);
+	struct nvos_firmware *cache;
+
+	if (fw) {
+		cache = container_of((struct firmware *)fw, typeof(*cache), fw);
+		mutex_lock(&nvos_firmware_mutex);
+		cache->refs--;
+		mutex_unlock(&nvos_firmware_mutex);
+	}
+}
+
+static void
+nvos_firmware_dump(void)
+{
+	fprintf(stderr, "firmware: hits %llu (%lld us) misses %llu (%lld us)\n",
+		nvos_firmware_stats.hits, nvos_firmware_stats.hit_ns / 1000,
+		nvos_firmware_stats.misses, nvos_firmware_stats.miss_ns / 1000);
+}
+
+static void __attribute__((constructor))
+nvos_firmware_init(void)
+{
+	if (getenv("NVOS_FW_STATS"))
+		atexit(nvos_firmware_dump);
 }
@@ -55,6 +55,8 @@ typedef int16_t __s16;
 typedef int8_t __s8;
 #endif
 
+#define U32_MAX ((u32)~0U)
+
 typedef u64 phys_addr_t;
 typedef u64 dma_addr_t;
 typedef dma_addr_t resource_size_t;
@@ -92,8 +94,16 @@ typedef dma_addr_t resource_size_t;
 #define unlikely(a) (a)
 #define BIT(a) (1UL << (a))
 #define BIT_ULL(a) (1ULL << (a))
+#define GENMASK(h,l) \
+	((~0UL << (l)) & (~0UL >> (sizeof(unsigned long) * 8 - 1 - (h))))
 #define ALIGN(a,b) (((a) + ((b) - 1)) & ~((b) - 1))
 
+#if defined(__i386__) || defined(__x86_64__)
+#define cpu_relax() __builtin_ia32_pause()
+#else
+#define cpu_relax() __asm__ __volatile__("" ::: "memory")
+#endif
+
 #define ERR_PTR(err) ((void *)(long)(err))
 #define PTR_ERR(ptr) ((long)(ptr))
 #define IS_ERR(ptr)  ((unsigned long)(ptr) >= (unsigned long)-4095)
@@ -208,6 +218,7 @@ put_unaligned_le32(u32 val, void *ptr)
 #define __ffs64(a) (__builtin_ffsll(a) - 1)
 #define __ffs(a) (__builtin_ffs(a) - 1)
 #define fls(a) ((a) ? sizeof(a) * 8 - __builtin_clz(a) : 0)
+#define fls64(a) ((a) ? 64 - __builtin_clzll(a) : 0)
 
 static inline int
 hweight8(u32 v) {
@@ -349,6 +360,19 @@ typedef struct atomic {
 #define atomic_xchg(a,b) \
 	__atomic_exchange_n(&(a)->value, (b), __ATOMIC_SEQ_CST)
 
+typedef struct {
+	s64 value;
+} atomic64_t;
+
+#define atomic64_read(a) __atomic_load_n(&(a)->value, __ATOMIC_RELAXED)
+#define atomic64_set(a,b) __atomic_store_n(&(a)->value, (b), __ATOMIC_RELAXED)
+#define atomic64_add(b,a) ((void) __sync_add_and_fetch(&(a)->value, (b)))
+
+#define READ_ONCE(a) __atomic_load_n(&(a), __ATOMIC_RELAXED)
+#define WRITE_ONCE(a,b) __atomic_store_n(&(a), (b), __ATOMIC_RELAXED)
+#define smp_load_acquire(a) __atomic_load_n((a), __ATOMIC_ACQUIRE)
+#define smp_store_release(a,b) __atomic_store_n((a), (b), __ATOMIC_RELEASE)
+
 /******************************************************************************
  * ktime
  *****************************************************************************/
@@ -453,6 +477,18 @@ typedef unsigned gfp_t;
 #define vzalloc(a) calloc(1, (a))
 #define vfree free
 
+/* there's only ever the one "cpu", updates from multiple threads are kept
+ * coherent with relaxed atomics instead
+ */
+#define __percpu
+#define alloc_percpu(a) ((a *)calloc(1, sizeof(a)))
+#define free_percpu free
+#define per_cpu_ptr(a,b) ((void)(b), (a))
+#define for_each_possible_cpu(a) for ((a) = 0; (a) < 1; (a)++)
+#define this_cpu_add(a,b) \
+	((void)__atomic_fetch_add(&(a), (b), __ATOMIC_RELAXED))
+#define this_cpu_inc(a) this_cpu_add((a), 1)
+
 static inline void *
 kmemdup(const void *src, size_t len, gfp_t gfp)
 {
@@ -462,6 +498,23 @@ kmemdup(const void *src, size_t len, gfp_t gfp)
 	return dst;
 }
 
+/******************************************************************************
+ * slab caches
+ *****************************************************************************/
+#define SLAB_HWCACHE_ALIGN 0x00002000UL
+
+struct kmem_cache;
+
+struct kmem_cache *kmem_cache_create(const char *, size_t, size_t,
+				     unsigned long, void (*)(void *));
+void kmem_cache_destroy(struct kmem_cache *);
+void *kmem_cache_alloc(struct kmem_cache *, gfp_t);
+void kmem_cache_free(struct kmem_cache *, void *);
+
+#define kmem_cache_zalloc(a,b) kmem_cache_alloc((a), (b) | __GFP_ZERO)
+#define KMEM_CACHE(s,f) kmem_cache_create(#s, sizeof(struct s),                \
+					  __alignof__(struct s), (f), NULL)
+
 struct page {
 };
 
@@ -578,6 +631,16 @@ nvos_backtrace(void)
 	_ret;                                                                  \
 })
 
+/******************************************************************************
+ * tasks - interrupt handlers run on threads of their own (see intr.c), so
+ * nothing is ever in interrupt context
+ *****************************************************************************/
+struct task_struct;
+extern __thread char nvos_task;
+
+#define current ((struct task_struct *)&nvos_task)
+#define in_interrupt() false
+
 /******************************************************************************
  * interrupts
  *****************************************************************************/
@@ -593,34 +656,81 @@ typedef irqreturn_t (*irq_handler_t)(int, void *);
 extern int  os_intr_init(unsigned int, irq_handler_t, unsigned long,
 			 const char *, void *);
 extern void os_intr_free(unsigned int, void *);
+extern int  os_intr_fd(unsigned int, void *, int);
+extern int  os_intr_stat(unsigned int, void *, u64 *, u64 *);
+extern void os_intr_raise(unsigned int);
 
 #define request_irq os_intr_init
 #define free_irq os_intr_free
 
 /******************************************************************************
- * spinlocks - using pthread mutex due to no static spinlock initialiser
+ * spinlocks - spin briefly, then sleep on a futex
  *****************************************************************************/
 #include <pthread.h>
 
+struct nvos_lock_class {
+	const char *name;
+	const char *file;
+	int line;
+	struct nvos_lock_class *next;
+	bool registered;
+	u64 acquired;
+	u64 contended;
+	u64 held;
+};
+
+/* state: 0 - unlocked, 1 - locked, 2 - locked, possibly with sleepers */
 typedef struct spinlock_t {
-	pthread_mutex_t lock;
+	u32 state;
+	struct nvos_lock_class *class;
+	s64 since;
 } spinlock_t;
 
-#define DEFINE_SPINLOCK(a) spinlock_t a = { .lock = PTHREAD_MUTEX_INITIALIZER }
+extern bool nvos_lock_stats;
+void nvos_spin_lock_slow(spinlock_t *);
+void nvos_spin_wake(spinlock_t *);
+void nvos_spin_stat_lock(spinlock_t *, bool);
+void nvos_spin_stat_unlock(spinlock_t *);
 
+#define DEFINE_SPINLOCK(a) spinlock_t a = {}
+
+/* one lock class per initialisation site, as with lockdep */
 #define spin_lock_init(a) do {                                                 \
-	(a)->lock = (pthread_mutex_t)PTHREAD_MUTEX_INITIALIZER;                \
+	static struct nvos_lock_class _class = {                               \
+		.name = #a, .file = __FILE__, .line = __LINE__,                \
+	};                                                                     \
+	*(a) = (spinlock_t) { .class = &_class };                              \
 } while(0)
-#define spin_lock(a) pthread_mutex_lock(&(a)->lock)
-#define spin_unlock(a) pthread_mutex_unlock(&(a)->lock)
+
+static inline void
+spin_lock(spinlock_t *lock)
+{
+	u32 state = 0;
+	bool contended = false;
+
+	if (unlikely(!__atomic_compare_exchange_n(&lock->state, &state, 1,
+						  false, __ATOMIC_ACQUIRE,
+						  __ATOMIC_RELAXED))) {
+		nvos_spin_lock_slow(lock);
+		contended = true;
+	}
+
+	if (unlikely(nvos_lock_stats))
+		nvos_spin_stat_lock(lock, contended);
+}
+
+static inline void
+spin_unlock(spinlock_t *lock)
+{
+	if (unlikely(nvos_lock_stats))
+		nvos_spin_stat_unlock(lock);
+	if (__atomic_exchange_n(&lock->state, 0, __ATOMIC_RELEASE) == 2)
+		nvos_spin_wake(lock);
+}
+
 #define spin_lock_irqsave(a,b) do { (b) = 1; spin_lock((a)); } while (0)
 #define spin_unlock_irqrestore(a,b) do { (void)(b); spin_unlock((a)); } while (0)
-#define spin_is_locked(a) ({ \
-	int _ret = pthread_mutex_trylock(&(a)->lock) != 0; \
-	if (_ret == 0) \
-		pthread_mutex_unlock(&(a)->lock); \
-	_ret; \
-})
+#define spin_is_locked(a) (__atomic_load_n(&(a)->state, __ATOMIC_RELAXED) != 0)
 #define assert_spin_locked(a) BUG_ON(!spin_is_locked(a))
 
 /******************************************************************************
@@ -636,6 +746,32 @@ typedef struct rwlock_t {
 #define write_lock_irq(a) pthread_rwlock_wrlock(&(a)->lock)
 #define write_unlock_irq(a) pthread_rwlock_unlock(&(a)->lock)
 
+/******************************************************************************
+ * rwsems
+ *****************************************************************************/
+struct rw_semaphore {
+	pthread_rwlock_t lock;
+};
+
+/* glibc prefers readers by default, the kernel doesn't let a stream of
+ * readers starve a writer
+ */
+static inline void
+init_rwsem(struct rw_semaphore *sem)
+{
+	pthread_rwlockattr_t attr;
+	pthread_rwlockattr_init(&attr);
+	pthread_rwlockattr_setkind_np(&attr,
+		PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+	pthread_rwlock_init(&sem->lock, &attr);
+	pthread_rwlockattr_destroy(&attr);
+}
+
+#define down_read(a) pthread_rwlock_rdlock(&(a)->lock)
+#define up_read(a) pthread_rwlock_unlock(&(a)->lock)
+#define down_write(a) pthread_rwlock_wrlock(&(a)->lock)
+#define up_write(a) pthread_rwlock_unlock(&(a)->lock)
+
 /******************************************************************************
  * mutexes
  *****************************************************************************/
@@ -673,18 +809,80 @@ struct rb_root {
 
 #define RB_ROOT (struct rb_root) {}
 
+enum rb_color {
+	RB_RED,
+	RB_BLACK,
+};
+
 struct rb_node {
 	struct rb_node *parent;
 	struct rb_node *rb_left;
 	struct rb_node *rb_right;
+	enum rb_color color;
 };
 
+#define RB_EMPTY_ROOT(a) ((a)->rb_node == NULL)
 #define RB_EMPTY_NODE(a) ((a)->parent == (a))
 #define RB_CLEAR_NODE(a) ((a)->parent = (a))
 
+#define rb_entry(ptr, type, member) container_of(ptr, type, member)
+
 void rb_link_node(struct rb_node *, struct rb_node *, struct rb_node **);
 void rb_insert_color(struct rb_node *, struct rb_root *);
 void rb_erase(struct rb_node *, struct rb_root *);
+struct rb_node *rb_first(const struct rb_root *);
+struct rb_node *rb_last(const struct rb_root *);
+struct rb_node *rb_next(const struct rb_node *);
+struct rb_node *rb_prev(const struct rb_node *);
+
+/* augmented rbtree, see linux's rbtree_augmented.h */
+struct rb_augment_callbacks {
+	void (*propagate)(struct rb_node *node, struct rb_node *stop);
+	void (*copy)(struct rb_node *old, struct rb_node *new);
+	void (*rotate)(struct rb_node *old, struct rb_node *new);
+};
+
+#define rb_parent(a) ((a)->parent)
+
+void rb_insert_augmented(struct rb_node *, struct rb_root *,
+			 const struct rb_augment_callbacks *);
+void rb_erase_augmented(struct rb_node *, struct rb_root *,
+			const struct rb_augment_callbacks *);
+
+#define RB_DECLARE_CALLBACKS(rbstatic, rbname, rbstruct, rbfield,              \
+			     rbtype, rbaugmented, rbcompute)                   \
+static inline void                                                             \
+rbname ## _propagate(struct rb_node *rb, struct rb_node *stop)                 \
+{                                                                              \
+	while (rb != stop) {                                                   \
+		rbstruct *node = rb_entry(rb, rbstruct, rbfield);              \
+		rbtype augmented = rbcompute(node);                            \
+		if (node->rbaugmented == augmented)                            \
+			break;                                                 \
+		node->rbaugmented = augmented;                                 \
+		rb = rb_parent(&node->rbfield);                                \
+	}                                                                      \
+}                                                                              \
+static inline void                                                             \
+rbname ## _copy(struct rb_node *rb_old, struct rb_node *rb_new)                \
+{                                                                              \
+	rbstruct *old = rb_entry(rb_old, rbstruct, rbfield);                   \
+	rbstruct *new = rb_entry(rb_new, rbstruct, rbfield);                   \
+	new->rbaugmented = old->rbaugmented;                                   \
+}                                                                              \
+static void                                                                    \
+rbname ## _rotate(struct rb_node *rb_old, struct rb_node *rb_new)              \
+{                                                                              \
+	rbstruct *old = rb_entry(rb_old, rbstruct, rbfield);                   \
+	rbstruct *new = rb_entry(rb_new, rbstruct, rbfield);                   \
+	new->rbaugmented = old->rbaugmented;                                   \
+	old->rbaugmented = rbcompute(old);                                     \
+}                                                                              \
+rbstatic const struct rb_augment_callbacks rbname = {                          \
+	.propagate = rbname ## _propagate,                                     \
+	.copy = rbname ## _copy,                                               \
+	.rotate = rbname ## _rotate                                            \
+};
 
 /******************************************************************************
  * io space
@@ -1196,7 +1394,10 @@ platform_get_irq_byname(struct platform_device *pdev, const char *name)
 /******************************************************************************
  * sg table
  *****************************************************************************/
+/* flat arrays only, there's no chaining */
 struct scatterlist {
+	dma_addr_t dma_address;
+	unsigned int dma_length;
 };
 
 struct sg_table {
@@ -1206,9 +1407,9 @@ struct sg_table {
 
 #define for_each_sg(sglist, sg, nr, __i)	                               \
 	for (__i = 0, sg = (sglist); __i < (nr); __i++, sg = sg_next(sg))
-#define sg_next(a) (a)
-#define sg_dma_address(a) 0ULL
-#define sg_dma_len(a) 0ULL
+#define sg_next(a) ((a) + 1)
+#define sg_dma_address(a) (a)->dma_address
+#define sg_dma_len(a) (a)->dma_length
 
 /******************************************************************************
  * firmware
@@ -1234,44 +1435,91 @@ struct work_struct {
 		void (*func)(struct work_struct *);
 		void (*exec)(void *);
 	};
+	struct list_head entry;
 	struct nvos_work *nvos;
+	unsigned long pending;
 };
 
-#define INIT_WORK(a,b) ((a)->func = (b), (a)->nvos = NULL)
-#define schedule_work(a) BUG_ON(!nvos_work_init((a)->exec, (a), &(a)->nvos))
-#define flush_work(a) nvos_work_fini(&(a)->nvos)
+#define INIT_WORK(a,b) ((a)->func = (b), (a)->nvos = NULL, (a)->pending = 0,   \
+			INIT_LIST_HEAD(&(a)->entry))
+#define schedule_work(a) nvos_work_queue((a))
+#define flush_work(a) nvos_work_flush((a))
+#define cancel_work_sync(a) nvos_work_cancel((a))
+#define work_pending(a) (__atomic_load_n(&(a)->pending, __ATOMIC_SEQ_CST) != 0)
+
+bool nvos_work_queue(struct work_struct *);
+bool nvos_work_flush(struct work_struct *);
+bool nvos_work_cancel(struct work_struct *);
 
-bool nvos_work_init(void (*)(void *), void *, struct nvos_work **);
-void nvos_work_fini(struct nvos_work **);
+#define WQ_UNBOUND (1 << 1)
+
+struct workqueue_struct;
+struct workqueue_struct *alloc_workqueue(const char *, unsigned int, int, ...);
+bool queue_work(struct workqueue_struct *, struct work_struct *);
+void flush_workqueue(struct workqueue_struct *);
+void destroy_workqueue(struct workqueue_struct *);
 
 /******************************************************************************
  * waitqueues
  *****************************************************************************/
 typedef struct __wait_queue_head {
+	u32 seq;
+	u32 waiters;
 } wait_queue_head_t;
 
-#define init_waitqueue_head(wq) (void)(wq)
-#define wake_up(wq) (void)(wq)
-#define wake_up_all(wq) (void)(wq)
+u32  nvos_wait_prepare(wait_queue_head_t *);
+void nvos_wait(wait_queue_head_t *, u32, s64);
+void nvos_wake_up(wait_queue_head_t *);
+
+#define init_waitqueue_head(wq) ((wq)->seq = 0, (wq)->waiters = 0)
+#define wake_up(wq) nvos_wake_up((wq))
+#define wake_up_all(wq) nvos_wake_up((wq))
+
+/* spin briefly before sleeping, most waits are over quickly */
+#define NVOS_WAIT_SPIN 128
 
 #define wait_event(wq,cond) do {                                               \
-	(void)(wq);                                                            \
-	usleep(1);                                                             \
-} while (!(cond))
+	int _spin = NVOS_WAIT_SPIN;                                            \
+	u32 _seq;                                                              \
+	while (!(cond)) {                                                      \
+		if (_spin) {                                                   \
+			_spin--;                                               \
+			cpu_relax();                                           \
+			continue;                                              \
+		}                                                              \
+		_seq = nvos_wait_prepare(&(wq));                               \
+		nvos_wait(&(wq), _seq, (cond) ? 0 : -1);                       \
+	}                                                                      \
+} while (0)
 
 #define wait_event_interruptible(wq,cond) ({                                   \
 	wait_event((wq), (cond)); 0;                                           \
 })
 
-#define wait_event_timeout(wq,cond,jiffies) ({                                 \
-	unsigned long _t = (jiffies) / 10000;                                  \
-	(void)(wq);                                                            \
-	do {                                                                   \
-		if (cond)                                                      \
+#define wait_event_timeout(wq,cond,timeout) ({                                 \
+	s64 _end = jiffies + (timeout), _now;                                  \
+	int _spin = NVOS_WAIT_SPIN;                                            \
+	long _ret;                                                             \
+	u32 _seq;                                                              \
+	for (;;) {                                                             \
+		_now = jiffies;                                                \
+		if (cond) {                                                    \
+			_ret = max_t(s64, _end - _now, 1);                     \
 			break;                                                 \
-		usleep(10);                                                    \
-	} while (--_t > 0);                                                    \
-	_t;                                                                    \
+		}                                                              \
+		if (_now >= _end) {                                            \
+			_ret = 0;                                              \
+			break;                                                 \
+		}                                                              \
+		if (_spin) {                                                   \
+			_spin--;                                               \
+			cpu_relax();                                           \
+			continue;                                              \
+		}                                                              \
+		_seq = nvos_wait_prepare(&(wq));                               \
+		nvos_wait(&(wq), _seq, (cond) ? 0 : _end - _now);              \
+	}                                                                      \
+	_ret;                                                                  \
 })
 
 #define wait_event_interruptible_timeout(wq,cond,jiffies)                      \
@@ -22,46 +22,181 @@
  * Authors: Ben Skeggs
  */
 
+#define _GNU_SOURCE /* ppoll() */
 #include <core/device.h>
 #include <core/client.h>
 #include "priv.h"
 
+#include <sys/eventfd.h>
+#include <poll.h>
+
+/* interrupt delivery, each handler gets a thread that sleeps on an eventfd
+ * (used by os_intr_raise(), and to stop the thread) and, if one's been
+ * attached with os_intr_fd(), a vfio-style interrupt eventfd
+ *
+ * without an interrupt fd, the handler is also polled at an interval that
+ * tightens to OS_INTR_POLL_MIN as soon as it reports an interrupt, and
+ * backs off towards OS_INTR_POLL_MAX while it keeps returning IRQ_NONE
+ */
+#define OS_INTR_POLL_MIN 100 /* us */
+#define OS_INTR_POLL_MAX 10000
+
 struct os_intr {
 	struct list_head head;
 	pthread_t thread;
 	irq_handler_t handler;
 	int irq;
 	void *dev;
+
+	int event;
+	int irqfd;
+	bool stop;
+	u64 handled;
+	u64 spurious;
 };
 static DEFINE_MUTEX(os_intr_mutex);
 static LIST_HEAD(os_intr_list);
 
+static void
+os_intr_kick(int fd)
+{
+	u64 count = 1;
+	if (write(fd, &count, sizeof(count)) != sizeof(count))
+		perror("intr kick");
+}
+
 static void *
 os_intr(void *arg)
 {
 	struct os_intr *intr = arg;
-	while (1) {
-		intr->handler(intr->irq, intr->dev);
-		usleep(10000);
+	struct pollfd fds[2] = {
+		{ .fd = intr->event, .events = POLLIN },
+		{ .fd = -1, .events = POLLIN },
+	};
+	u32 wait = OS_INTR_POLL_MIN;
+	u64 count;
+
+	while (!__atomic_load_n(&intr->stop, __ATOMIC_ACQUIRE)) {
+		struct timespec timeout = {
+			.tv_sec = wait / 1000000,
+			.tv_nsec = (wait % 1000000) * 1000,
+		};
+
+		fds[1].fd = __atomic_load_n(&intr->irqfd, __ATOMIC_ACQUIRE);
+		if (ppoll(fds, 2, fds[1].fd < 0 ? &timeout : NULL, NULL) < 0)
+			continue;
+
+		if ((fds[0].revents & POLLIN) &&
+		    read(fds[0].fd, &count, sizeof(count)) < 0)
+			perror("intr event");
+		if ((fds[1].revents & POLLIN) &&
+		    read(fds[1].fd, &count, sizeof(count)) < 0)
+			perror("intr irqfd");
+		if (__atomic_load_n(&intr->stop, __ATOMIC_ACQUIRE))
+			break;
+
+		if (intr->handler(intr->irq, intr->dev) == IRQ_HANDLED) {
+			__atomic_add_fetch(&intr->handled, 1, __ATOMIC_RELAXED);
+			wait = OS_INTR_POLL_MIN;
+		} else {
+			__atomic_add_fetch(&intr->spurious, 1, __ATOMIC_RELAXED);
+			wait = min(wait * 2, (u32)OS_INTR_POLL_MAX);
+		}
+	}
+
+	return NULL;
+}
+
+static struct os_intr *
+os_intr_find(unsigned int irq, void *dev)
+{
+	struct os_intr *intr;
+	list_for_each_entry(intr, &os_intr_list, head) {
+		if (intr->irq == irq && intr->dev == dev)
+			return intr;
 	}
 	return NULL;
 }
 
+/* fake interrupt source, kicks every handler registered on the irq */
+void
+os_intr_raise(unsigned int irq)
+{
+	struct os_intr *intr;
+
+	mutex_lock(&os_intr_mutex);
+	list_for_each_entry(intr, &os_intr_list, head) {
+		if (intr->irq == irq)
+			os_intr_kick(intr->event);
+	}
+	mutex_unlock(&os_intr_mutex);
+}
+
+int
+os_intr_fd(unsigned int irq, void *dev, int fd)
+{
+	struct os_intr *intr;
+	int ret = -ENOENT;
+
+	mutex_lock(&os_intr_mutex);
+	if ((intr = os_intr_find(irq, dev))) {
+		__atomic_store_n(&intr->irqfd, fd, __ATOMIC_RELEASE);
+		os_intr_kick(intr->event);
+		ret = 0;
+	}
+	mutex_unlock(&os_intr_mutex);
+	return ret;
+}
+
+int
+os_intr_stat(unsigned int irq, void *dev, u64 *handled, u64 *spurious)
+{
+	struct os_intr *intr;
+	int ret = -ENOENT;
+
+	mutex_lock(&os_intr_mutex);
+	if ((intr = os_intr_find(irq, dev))) {
+		*handled = __atomic_load_n(&intr->handled, __ATOMIC_RELAXED);
+		*spurious = __atomic_load_n(&intr->spurious, __ATOMIC_RELAXED);
+		ret = 0;
+	}
+	mutex_unlock(&os_intr_mutex);
+	return ret;
+}
+
 int
 os_intr_init(unsigned int irq, irq_handler_t handler, unsigned long flags,
 	     const char *name, void *dev)
 {
-	struct os_intr *intr = malloc(sizeof(*intr));
+	struct os_intr *intr = calloc(1, sizeof(*intr));
+	int ret;
+
 	if (!intr)
 		return -ENOMEM;
 	intr->handler = handler;
 	intr->irq = irq;
 	intr->dev = dev;
+	intr->irqfd = -1;
+
+	intr->event = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (intr->event < 0) {
+		ret = -errno;
+		goto fail_event;
+	}
+
+	if ((ret = -pthread_create(&intr->thread, NULL, os_intr, intr)))
+		goto fail_thread;
+
 	mutex_lock(&os_intr_mutex);
 	list_add(&intr->head, &os_intr_list);
 	mutex_unlock(&os_intr_mutex);
-	pthread_create(&intr->thread, NULL, os_intr, intr);
 	return 0;
+
+fail_thread:
+	close(intr->event);
+fail_event:
+	free(intr);
+	return ret;
 }
 
 void
@@ -70,15 +205,15 @@ os_intr_free(unsigned int irq, void *dev)
 	struct os_intr *intr;
 
 	mutex_lock(&os_intr_mutex);
-	list_for_each_entry(intr, &os_intr_list, head) {
-		if (intr->irq == irq && intr->dev == dev) {
-			pthread_cancel(intr->thread);
-			pthread_join(intr->thread, NULL);
-			list_del(&intr->head);
-			mutex_unlock(&os_intr_mutex);
-			free(intr);
-			return;
-		}
-	}
+	if ((intr = os_intr_find(irq, dev)))
+		list_del(&intr->head);
 	mutex_unlock(&os_intr_mutex);
+
+	if (intr) {
+		__atomic_store_n(&intr->stop, true, __ATOMIC_RELEASE);
+		os_intr_kick(intr->event);
+		pthread_join(intr->thread, NULL);
+		close(intr->event);
+		free(intr);
+	}
 }
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2016 Red Hat Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDER(S) OR AUTHOR(S) BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Authors: Ben Skeggs <bskeggs@redhat.com>
+ */
+#include "priv.h"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+/* spin for about the length of a short critical section before sleeping,
+ * waiters aren't served in order, handing the lock to a specific thread
+ * that's been preempted would stall everyone else behind it
+ */
+#define NVOS_SPIN 128
+
+/* NVOS_LOCK_STATS in the environment enables per-class counters, which are
+ * dumped at exit
+ */
+bool nvos_lock_stats;
+static struct nvos_lock_class *nvos_lock_classes;
+
+void
+nvos_spin_lock_slow(spinlock_t *lock)
+{
+	u32 state;
+	int spin;
+
+	for (spin = 0; spin < NVOS_SPIN; spin++) {
+		cpu_relax();
+		state = 0;
+		if (__atomic_load_n(&lock->state, __ATOMIC_RELAXED) == 0 &&
+		    __atomic_compare_exchange_n(&lock->state, &state, 1, false,
+						__ATOMIC_ACQUIRE,
+						__ATOMIC_RELAXED))
+			return;
+	}
+
+	while (__atomic_exchange_n(&lock->state, 2, __ATOMIC_ACQUIRE) != 0) {
+		syscall(SYS_futex, &lock->state, FUTEX_WAIT_PRIVATE, 2,
+			NULL, NULL, 0);
+	}
+}
+
+void
+nvos_spin_wake(spinlock_t *lock)
+{
+	syscall(SYS_futex, &lock->state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+void
+nvos_spin_stat_lock(spinlock_t *lock, bool contended)
+{
+	struct nvos_lock_class *class = lock->class;
+
+	if (!class)
+		return;
+
+	if (!__atomic_exchange_n(&class->registered, true, __ATOMIC_ACQ_REL)) {
+		class->next = __atomic_load_n(&nvos_lock_classes,
+					      __ATOMIC_ACQUIRE);
+		while (!__atomic_compare_exchange_n(&nvos_lock_classes,
+						    &class->next, class, false,
+						    __ATOMIC_ACQ_REL,
+						    __ATOMIC_ACQUIRE)) {
+		}
+	}
+
+	__atomic_add_fetch(&class->acquired, 1, __ATOMIC_RELAXED);
+	if (contended)
+		__atomic_add_fetch(&class->contended, 1, __ATOMIC_RELAXED);
+	lock->since = ktime_to_ns(ktime_get());
+}
+
+void
+nvos_spin_stat_unlock(spinlock_t *lock)
+{
+	struct nvos_lock_class *class = lock->class;
+	if (class) {
+		s64 held = ktime_to_ns(ktime_get()) - lock->since;
+		__atomic_add_fetch(&class->held, held, __ATOMIC_RELAXED);
+	}
+}
+
+static void
+nvos_lock_dump(void)
+{
+	struct nvos_lock_class *class;
+
+	for (class = nvos_lock_classes; class; class = class->next) {
+		fprintf(stderr, "lock: %s (%s:%d) acquired %llu contended "
+				"%llu held %lluns (avg %lluns)\n",
+			class->name, class->file, class->line,
+			class->acquired, class->contended, class->held,
+			class->held / max(class->acquired, 1ULL));
+	}
+}
+
+static void __attribute__((constructor))
+nvos_lock_init(void)
+{
+	if (getenv("NVOS_LOCK_STATS")) {
+		nvos_lock_stats = true;
+		atexit(nvos_lock_dump);
+	}
+}
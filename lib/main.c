@@ -36,52 +36,139 @@
 #include "priv.h"
 
 static DEFINE_MUTEX(os_mutex);
+static DEFINE_MUTEX(os_device_mutex);
 static LIST_HEAD(os_device_list);
 static int os_client_nr = 0;
 
 bool os_device_detect = true;
 bool os_device_mmio = true;
+bool os_device_wc = true;
 u64  os_device_subdev = ~0ULL;
 
+/* only its address is used, as a per-thread "current" */
+__thread char nvos_task;
+
 /******************************************************************************
  * horrific stuff to implement linux's ioremap interface on top of pciaccess
  *****************************************************************************/
+/* BARs are mapped whole, and shared by every ioremap() that lands in them,
+ * the mappings are indexed by both bus and cpu address
+ *
+ * prefetchable BARs (the VRAM apertures) are mapped write-combined, unless
+ * os_device_wc has been cleared, the register BAR stays uncached
+ */
 static DEFINE_MUTEX(os_ioremap_mutex);
-static struct os_ioremap_info {
-       struct pci_device *pdev;
-       int refs;
-       u64 addr;
-       u64 size;
-       void *ptr;
-} os_ioremap[32];
+static struct rb_root os_ioremap_addr = RB_ROOT;
+static struct rb_root os_ioremap_ptr = RB_ROOT;
+
+struct os_ioremap_info {
+	struct rb_node addr_node;
+	struct rb_node ptr_node;
+	struct pci_device *pdev;
+	int refs;
+	u64 addr;
+	u64 size;
+	void *ptr;
+};
+
+static struct os_ioremap_info *
+os_ioremap_find_addr(u64 addr)
+{
+	struct rb_node *node = os_ioremap_addr.rb_node;
+	while (node) {
+		struct os_ioremap_info *info =
+			rb_entry(node, typeof(*info), addr_node);
+		if (addr < info->addr)
+			node = node->rb_left;
+		else
+		if (addr >= info->addr + info->size)
+			node = node->rb_right;
+		else
+			return info;
+	}
+	return NULL;
+}
+
+static struct os_ioremap_info *
+os_ioremap_find_ptr(void *ptr)
+{
+	struct rb_node *node = os_ioremap_ptr.rb_node;
+	while (node) {
+		struct os_ioremap_info *info =
+			rb_entry(node, typeof(*info), ptr_node);
+		if (ptr < info->ptr)
+			node = node->rb_left;
+		else
+		if (ptr >= info->ptr + info->size)
+			node = node->rb_right;
+		else
+			return info;
+	}
+	return NULL;
+}
+
+static void
+os_ioremap_insert(struct os_ioremap_info *info)
+{
+	struct rb_node **ptr, *parent;
+
+	ptr = &os_ioremap_addr.rb_node;
+	parent = NULL;
+	while (*ptr) {
+		struct os_ioremap_info *this =
+			rb_entry(*ptr, typeof(*this), addr_node);
+		parent = *ptr;
+		if (info->addr < this->addr)
+			ptr = &parent->rb_left;
+		else
+			ptr = &parent->rb_right;
+	}
+	rb_link_node(&info->addr_node, parent, ptr);
+	rb_insert_color(&info->addr_node, &os_ioremap_addr);
+
+	ptr = &os_ioremap_ptr.rb_node;
+	parent = NULL;
+	while (*ptr) {
+		struct os_ioremap_info *this =
+			rb_entry(*ptr, typeof(*this), ptr_node);
+		parent = *ptr;
+		if (info->ptr < this->ptr)
+			ptr = &parent->rb_left;
+		else
+			ptr = &parent->rb_right;
+	}
+	rb_link_node(&info->ptr_node, parent, ptr);
+	rb_insert_color(&info->ptr_node, &os_ioremap_ptr);
+}
 
 void __iomem *
 nvos_ioremap_bar(struct pci_device *pdev, int bar, u64 addr)
 {
 	u64 base = pdev->regions[bar].base_addr;
 	u64 size = pdev->regions[bar].size;
-	u64 offset = addr - base;
+	struct os_ioremap_info *info;
 	void __iomem *ptr = NULL;
-	int i;
+	unsigned flags = PCI_DEV_MAP_FLAG_WRITABLE;
 
-	mutex_lock(&os_ioremap_mutex);
-	for (i = 0; !ptr && i < ARRAY_SIZE(os_ioremap); i++) {
-		if (os_ioremap[i].refs && os_ioremap[i].addr == base) {
-			os_ioremap[i].refs++;
-			ptr = os_ioremap[i].ptr + offset;
-		}
-	}
+	if (pdev->regions[bar].is_prefetchable && os_device_wc)
+		flags |= PCI_DEV_MAP_FLAG_WRITE_COMBINE;
 
-	for (i = 0; !ptr && i < ARRAY_SIZE(os_ioremap); i++) {
-		if (!os_ioremap[i].refs &&
-		    !pci_device_map_range(pdev, base, size,
-					  PCI_DEV_MAP_FLAG_WRITABLE,
-					  &os_ioremap[i].ptr)) {
-			os_ioremap[i].pdev = pdev;
-			os_ioremap[i].refs = 1;
-			os_ioremap[i].addr = base;
-			os_ioremap[i].size = size;
-			ptr = os_ioremap[i].ptr + offset;
+	mutex_lock(&os_ioremap_mutex);
+	if ((info = os_ioremap_find_addr(base))) {
+		info->refs++;
+		ptr = info->ptr + (addr - base);
+	} else
+	if ((info = calloc(1, sizeof(*info)))) {
+		if (!pci_device_map_range(pdev, base, size, flags,
+					  &info->ptr)) {
+			info->pdev = pdev;
+			info->refs = 1;
+			info->addr = base;
+			info->size = size;
+			os_ioremap_insert(info);
+			ptr = info->ptr + (addr - base);
+		} else {
+			free(info);
 		}
 	}
 	mutex_unlock(&os_ioremap_mutex);
@@ -89,42 +176,48 @@ nvos_ioremap_bar(struct pci_device *pdev, int bar, u64 addr)
 	return ptr;
 }
 
+/* os_device_mutex protects the BAR index, see os_init_device() */
+static struct rb_root os_device_bars = RB_ROOT;
+
 void __iomem *
 nvos_ioremap(u64 addr, u64 size)
 {
-	struct os_device *odev;
-	int i;
+	struct rb_node *node;
+	void __iomem *ptr = NULL;
 
-	list_for_each_entry(odev, &os_device_list, head) {
-		struct pci_device *pdev = odev->pdev.pdev;
-		for (i = 0; i < ARRAY_SIZE(pdev->regions); i++) {
-			if (addr        >= pdev->regions[i].base_addr &&
-			    addr + size <= pdev->regions[i].base_addr +
-					   pdev->regions[i].size) {
-				return nvos_ioremap_bar(pdev, i, addr);
-			}
+	mutex_lock(&os_device_mutex);
+	node = os_device_bars.rb_node;
+	while (node) {
+		struct os_device_bar *bar = rb_entry(node, typeof(*bar), node);
+		struct pci_mem_region *region = &bar->pdev->regions[bar->bar];
+		if (addr < region->base_addr) {
+			node = node->rb_left;
+		} else
+		if (addr >= region->base_addr + region->size) {
+			node = node->rb_right;
+		} else {
+			if (addr + size <= region->base_addr + region->size)
+				ptr = nvos_ioremap_bar(bar->pdev, bar->bar, addr);
+			break;
 		}
 	}
-
-	return NULL;
+	mutex_unlock(&os_device_mutex);
+	return ptr;
 }
 
 void
 nvos_iounmap(void __iomem *ptr)
 {
-	int i;
+	struct os_ioremap_info *info;
 
 	mutex_lock(&os_ioremap_mutex);
-	for (i = 0; ptr && i < ARRAY_SIZE(os_ioremap); i++) {
-		if (os_ioremap[i].refs &&
-		    ptr >= os_ioremap[i].ptr &&
-		    ptr <  os_ioremap[i].ptr + os_ioremap[i].size) {
-			if (!--os_ioremap[i].refs) {
-				pci_device_unmap_range(os_ioremap[i].pdev,
-						       os_ioremap[i].ptr,
-						       os_ioremap[i].size);
-			}
-			break;
+	if (ptr && (info = os_ioremap_find_ptr(ptr))) {
+		if (!--info->refs) {
+			rb_erase(&info->addr_node, &os_ioremap_addr);
+			rb_erase(&info->ptr_node, &os_ioremap_ptr);
+			pci_device_unmap_range(info->pdev, info->ptr,
+					       info->size);
+			free(info);
 		}
 	}
 	mutex_unlock(&os_ioremap_mutex);
@@ -136,8 +229,16 @@ nvos_iounmap(void __iomem *ptr)
 static void
 os_fini_device(struct os_device *odev)
 {
+	int i;
+
 	nvkm_device_del(&odev->device);
+	mutex_lock(&os_device_mutex);
+	for (i = 0; i < ARRAY_SIZE(odev->bar); i++) {
+		if (!RB_EMPTY_NODE(&odev->bar[i].node))
+			rb_erase(&odev->bar[i].node, &os_device_bars);
+	}
 	list_del(&odev->head);
+	mutex_unlock(&os_device_mutex);
 	kfree(odev);
 }
 
@@ -145,13 +246,8 @@ static int
 os_init_device(struct pci_device *pdev, const char *cfg, const char *dbg)
 {
 	struct os_device *odev;
-	int ret;
-
-	ret = pci_device_probe(pdev);
-	if (ret) {
-		fprintf(stderr, "pci_device_probe failed, %d\n", ret);
-		return ret;
-	}
+	s64 time = ktime_to_ns(ktime_get());
+	int ret, i;
 
 	odev = calloc(1, sizeof(*odev));
 	if (!odev)
@@ -169,26 +265,84 @@ os_init_device(struct pci_device *pdev, const char *cfg, const char *dbg)
 	odev->pdev._bus.number = pdev->bus;
 	odev->pdev.bus = &odev->pdev._bus;
 	odev->pdev.devfn = PCI_DEVFN(pdev->dev, pdev->func);
+	mutex_lock(&os_device_mutex);
+	for (i = 0; i < ARRAY_SIZE(odev->bar); i++) {
+		struct os_device_bar *bar = &odev->bar[i];
+		struct rb_node **ptr = &os_device_bars.rb_node;
+		struct rb_node *parent = NULL;
+
+		RB_CLEAR_NODE(&bar->node);
+		if (!pdev->regions[i].size)
+			continue;
+		bar->pdev = pdev;
+		bar->bar = i;
+
+		while (*ptr) {
+			struct os_device_bar *this =
+				rb_entry(*ptr, typeof(*this), node);
+			parent = *ptr;
+			if (pdev->regions[i].base_addr <
+			    this->pdev->regions[this->bar].base_addr)
+				ptr = &parent->rb_left;
+			else
+				ptr = &parent->rb_right;
+		}
+
+		rb_link_node(&bar->node, parent, ptr);
+		rb_insert_color(&bar->node, &os_device_bars);
+	}
 	list_add_tail(&odev->head, &os_device_list);
+	mutex_unlock(&os_device_mutex);
 
 	ret = nvkm_device_pci_new(&odev->pdev, cfg, dbg, os_device_detect,
 				  os_device_mmio, os_device_subdev,
 				  &odev->device);
 	if (ret) {
-		fprintf(stderr, "failed to create device, %d\n", ret);
+		fprintf(stderr, "%s: failed to create device, %d\n",
+			odev->pdev.dev.name, ret);
 		os_fini_device(odev);
 		return ret;
 	}
 
+	time = ktime_to_ns(ktime_get()) - time;
+	nvdev_debug(odev->device, "probed in %lld us\n", time / 1000);
 	return 0;
 }
 
+/* devices are constructed in parallel, the vbios shadowing in particular is
+ * slow enough that probing them one at a time adds up on multi-gpu systems
+ */
+#define OS_PROBE_MAX 8
+
+struct os_probe {
+	struct pci_device **pdev;
+	int nr;
+	int next;
+	const char *cfg;
+	const char *dbg;
+};
+
+static void *
+os_probe(void *data)
+{
+	struct os_probe *probe = data;
+	int i;
+
+	while ((i = __atomic_fetch_add(&probe->next, 1, __ATOMIC_RELAXED)) <
+	       probe->nr)
+		os_init_device(probe->pdev[i], probe->cfg, probe->dbg);
+
+	return NULL;
+}
+
 static int
 os_init(const char *cfg, const char *dbg)
 {
+	struct os_probe probe = { .cfg = cfg, .dbg = dbg };
+	pthread_t thread[OS_PROBE_MAX - 1];
 	struct pci_device_iterator *iter;
-	struct pci_device *pdev;
-	int ret;
+	struct pci_device *pdev, **temp;
+	int ret, nr = 0, i;
 
 	ret = pci_system_init();
 	if (ret) {
@@ -203,9 +357,32 @@ os_init(const char *cfg, const char *dbg)
 		if (pdev->vendor_id != 0x10de)
 			continue;
 
-		os_init_device(pdev, cfg, dbg);
+		ret = pci_device_probe(pdev);
+		if (ret) {
+			fprintf(stderr, "pci_device_probe failed, %d\n", ret);
+			continue;
+		}
+
+		temp = realloc(probe.pdev, (probe.nr + 1) * sizeof(*temp));
+		if (!temp)
+			break;
+		probe.pdev = temp;
+		probe.pdev[probe.nr++] = pdev;
 	}
 	pci_iterator_destroy(iter);
+
+	/* the calling thread probes too, so one less thread than tasks */
+	for (i = 0; i < min(probe.nr, OS_PROBE_MAX) - 1; i++) {
+		if (pthread_create(&thread[nr], NULL, os_probe, &probe))
+			break;
+		nr++;
+	}
+
+	os_probe(&probe);
+
+	while (nr--)
+		pthread_join(thread[nr], NULL);
+	free(probe.pdev);
 	return 0;
 }
 
@@ -12,9 +12,16 @@ struct os_device {
 	char *cfg;
 	char *dbg;
 	struct pci_dev pdev;
+
+	struct os_device_bar {
+		struct rb_node node;
+		struct pci_device *pdev;
+		int bar;
+	} bar[6];
 };
 
 extern bool os_device_detect;
 extern bool os_device_mmio;
+extern bool os_device_wc;
 extern u64  os_device_subdev;
 #endif
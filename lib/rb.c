@@ -23,70 +23,361 @@
  */
 #include <core/os.h>
 
-/*XXX: this is just an unbalanced bst with linux's rbtree interface */
+/* red-black tree with linux's rbtree interface, each node carries its colour
+ * alongside the parent pointer rather than packing it into the low bits
+ */
+
+static inline bool
+rb_is_red(struct rb_node *node)
+{
+	return node && node->color == RB_RED;
+}
+
+static inline bool
+rb_is_black(struct rb_node *node)
+{
+	return !rb_is_red(node);
+}
+
+static inline void
+rb_change_child(struct rb_node *old, struct rb_node *new,
+		struct rb_node *parent, struct rb_root *root)
+{
+	if (parent) {
+		if (parent->rb_left == old)
+			parent->rb_left = new;
+		else
+			parent->rb_right = new;
+	} else {
+		root->rb_node = new;
+	}
+}
+
+static void
+rb_augment_dummy_propagate(struct rb_node *node, struct rb_node *stop)
+{
+}
+
+static void
+rb_augment_dummy_copy(struct rb_node *old, struct rb_node *new)
+{
+}
+
+static void
+rb_augment_dummy_rotate(struct rb_node *old, struct rb_node *new)
+{
+}
+
+static const struct rb_augment_callbacks
+rb_augment_dummy = {
+	.propagate = rb_augment_dummy_propagate,
+	.copy = rb_augment_dummy_copy,
+	.rotate = rb_augment_dummy_rotate,
+};
+
+static void
+rb_rotate_left(struct rb_node *node, struct rb_root *root,
+	       const struct rb_augment_callbacks *augment)
+{
+	struct rb_node *right = node->rb_right;
+	struct rb_node *parent = node->parent;
+
+	if ((node->rb_right = right->rb_left))
+		right->rb_left->parent = node;
+	right->rb_left = node;
+	right->parent = parent;
+	rb_change_child(node, right, parent, root);
+	node->parent = right;
+	augment->rotate(node, right);
+}
+
+static void
+rb_rotate_right(struct rb_node *node, struct rb_root *root,
+		const struct rb_augment_callbacks *augment)
+{
+	struct rb_node *left = node->rb_left;
+	struct rb_node *parent = node->parent;
+
+	if ((node->rb_left = left->rb_right))
+		left->rb_right->parent = node;
+	left->rb_right = node;
+	left->parent = parent;
+	rb_change_child(node, left, parent, root);
+	node->parent = left;
+	augment->rotate(node, left);
+}
 
 void
 rb_link_node(struct rb_node *node, struct rb_node *parent, struct rb_node **ptr)
 {
 	node->parent = parent;
+	node->color = RB_RED;
+	node->rb_left = node->rb_right = NULL;
 	*ptr = node;
 }
 
+static void
+rb_insert(struct rb_node *node, struct rb_root *root,
+	  const struct rb_augment_callbacks *augment)
+{
+	struct rb_node *parent, *gparent, *uncle;
+
+	while ((parent = node->parent) && rb_is_red(parent)) {
+		/* a red parent is never the root, so gparent must exist */
+		gparent = parent->parent;
+
+		if (parent == gparent->rb_left) {
+			uncle = gparent->rb_right;
+			if (rb_is_red(uncle)) {
+				/* recolour and continue from grandparent */
+				uncle->color = RB_BLACK;
+				parent->color = RB_BLACK;
+				gparent->color = RB_RED;
+				node = gparent;
+				continue;
+			}
+
+			if (node == parent->rb_right) {
+				rb_rotate_left(parent, root, augment);
+				node = parent;
+				parent = node->parent;
+			}
+
+			parent->color = RB_BLACK;
+			gparent->color = RB_RED;
+			rb_rotate_right(gparent, root, augment);
+		} else {
+			uncle = gparent->rb_left;
+			if (rb_is_red(uncle)) {
+				uncle->color = RB_BLACK;
+				parent->color = RB_BLACK;
+				gparent->color = RB_RED;
+				node = gparent;
+				continue;
+			}
+
+			if (node == parent->rb_left) {
+				rb_rotate_right(parent, root, augment);
+				node = parent;
+				parent = node->parent;
+			}
+
+			parent->color = RB_BLACK;
+			gparent->color = RB_RED;
+			rb_rotate_left(gparent, root, augment);
+		}
+	}
+
+	root->rb_node->color = RB_BLACK;
+}
+
 void
 rb_insert_color(struct rb_node *node, struct rb_root *root)
 {
+	rb_insert(node, root, &rb_augment_dummy);
 }
 
 void
-rb_erase(struct rb_node *node, struct rb_root *root)
+rb_insert_augmented(struct rb_node *node, struct rb_root *root,
+		    const struct rb_augment_callbacks *augment)
 {
-	struct rb_node **ptr;
+	rb_insert(node, root, augment);
+}
 
-	/* determine which parent pointer needs replacing */
-	if (node->parent) {
-		if (node == node->parent->rb_left)
-			ptr = &node->parent->rb_left;
-		else
-			ptr = &node->parent->rb_right;
-	} else {
-		ptr = &root->rb_node;
+static void
+rb_erase_color(struct rb_node *node, struct rb_node *parent,
+	       struct rb_root *root, const struct rb_augment_callbacks *augment)
+{
+	struct rb_node *sibling;
+
+	/* 'node' (possibly NULL) is carrying an extra black, push it up
+	 * the tree until it can be absorbed by a red node or the root
+	 */
+	while (node != root->rb_node && rb_is_black(node)) {
+		if (node == parent->rb_left) {
+			sibling = parent->rb_right;
+			if (rb_is_red(sibling)) {
+				sibling->color = RB_BLACK;
+				parent->color = RB_RED;
+				rb_rotate_left(parent, root, augment);
+				sibling = parent->rb_right;
+			}
+
+			if (rb_is_black(sibling->rb_left) &&
+			    rb_is_black(sibling->rb_right)) {
+				sibling->color = RB_RED;
+				node = parent;
+				parent = node->parent;
+				continue;
+			}
+
+			if (rb_is_black(sibling->rb_right)) {
+				sibling->rb_left->color = RB_BLACK;
+				sibling->color = RB_RED;
+				rb_rotate_right(sibling, root, augment);
+				sibling = parent->rb_right;
+			}
+
+			sibling->color = parent->color;
+			parent->color = RB_BLACK;
+			sibling->rb_right->color = RB_BLACK;
+			rb_rotate_left(parent, root, augment);
+		} else {
+			sibling = parent->rb_left;
+			if (rb_is_red(sibling)) {
+				sibling->color = RB_BLACK;
+				parent->color = RB_RED;
+				rb_rotate_right(parent, root, augment);
+				sibling = parent->rb_left;
+			}
+
+			if (rb_is_black(sibling->rb_left) &&
+			    rb_is_black(sibling->rb_right)) {
+				sibling->color = RB_RED;
+				node = parent;
+				parent = node->parent;
+				continue;
+			}
+
+			if (rb_is_black(sibling->rb_left)) {
+				sibling->rb_right->color = RB_BLACK;
+				sibling->color = RB_RED;
+				rb_rotate_left(sibling, root, augment);
+				sibling = parent->rb_left;
+			}
+
+			sibling->color = parent->color;
+			parent->color = RB_BLACK;
+			sibling->rb_left->color = RB_BLACK;
+			rb_rotate_right(parent, root, augment);
+		}
+
+		node = root->rb_node;
+		break;
 	}
 
+	if (node)
+		node->color = RB_BLACK;
+}
+
+static void
+rb_erase_(struct rb_node *node, struct rb_root *root,
+	  const struct rb_augment_callbacks *augment)
+{
+	struct rb_node *child, *parent;
+	enum rb_color color;
+
 	if (node->rb_left && node->rb_right) {
-		/* find the largest value to the left of the deleted
-		 * node, this will take its place in the tree
-		 */
-		struct rb_node *lr = node->rb_left;
-		while (lr->rb_right)
-			lr = lr->rb_right;
-		/* if this isn't the immediate left of the deleted node,
-		 * search down to find the smallest value and link the
-		 * immediate left of the deleted node there
+		/* replace the deleted node with its in-order successor,
+		 * which has no left child, and fix up from where the
+		 * successor was unlinked
 		 */
-		if (node->rb_left != lr) {
-			struct rb_node *lrl = lr;
-			while (lrl->rb_left)
-				lrl = lrl->rb_left;
-			lrl->rb_left = node->rb_left;
-			lrl->rb_left->parent = lrl;
-			lr->parent->rb_right = NULL;
+		struct rb_node *next = node->rb_right;
+		while (next->rb_left)
+			next = next->rb_left;
+
+		child = next->rb_right;
+		parent = next->parent;
+		color = next->color;
+
+		if (parent == node) {
+			parent = next;
+			augment->copy(node, next);
+		} else {
+			if ((parent->rb_left = child))
+				child->parent = parent;
+			next->rb_right = node->rb_right;
+			next->rb_right->parent = next;
+			augment->copy(node, next);
+			augment->propagate(parent, next);
 		}
-		/* link into the deleted node's position */
-		lr->parent = node->parent;
-		lr->rb_right = node->rb_right;
-		lr->rb_right->parent = lr;
-		*ptr = lr;
-	} else
-	if (node->rb_left) {
-		/* move left node into the deleted node's position */
-		node->rb_left->parent = node->parent;
-		*ptr = node->rb_left;
-	} else
-	if (node->rb_right) {
-		/* move right node into the deleted node's position */
-		node->rb_right->parent = node->parent;
-		*ptr = node->rb_right;
+
+		next->rb_left = node->rb_left;
+		next->rb_left->parent = next;
+		next->parent = node->parent;
+		next->color = node->color;
+		rb_change_child(node, next, node->parent, root);
+		augment->propagate(next, NULL);
 	} else {
-		*ptr = NULL;
+		child = node->rb_left ? node->rb_left : node->rb_right;
+		parent = node->parent;
+		color = node->color;
+
+		if (child)
+			child->parent = parent;
+		rb_change_child(node, child, parent, root);
+		augment->propagate(parent, NULL);
+	}
+
+	if (color == RB_BLACK)
+		rb_erase_color(child, parent, root, augment);
+}
+
+void
+rb_erase(struct rb_node *node, struct rb_root *root)
+{
+	rb_erase_(node, root, &rb_augment_dummy);
+}
+
+void
+rb_erase_augmented(struct rb_node *node, struct rb_root *root,
+		   const struct rb_augment_callbacks *augment)
+{
+	rb_erase_(node, root, augment);
+}
+
+struct rb_node *
+rb_first(const struct rb_root *root)
+{
+	struct rb_node *node = root->rb_node;
+	if (node) {
+		while (node->rb_left)
+			node = node->rb_left;
 	}
+	return node;
+}
+
+struct rb_node *
+rb_last(const struct rb_root *root)
+{
+	struct rb_node *node = root->rb_node;
+	if (node) {
+		while (node->rb_right)
+			node = node->rb_right;
+	}
+	return node;
+}
+
+struct rb_node *
+rb_next(const struct rb_node *node)
+{
+	struct rb_node *parent;
+
+	if (node->rb_right) {
+		node = node->rb_right;
+		while (node->rb_left)
+			node = node->rb_left;
+		return (struct rb_node *)node;
+	}
+
+	while ((parent = node->parent) && node == parent->rb_right)
+		node = parent;
+	return parent;
+}
+
+struct rb_node *
+rb_prev(const struct rb_node *node)
+{
+	struct rb_node *parent;
+
+	if (node->rb_left) {
+		node = node->rb_left;
+		while (node->rb_right)
+			node = node->rb_right;
+		return (struct rb_node *)node;
+	}
+
+	while ((parent = node->parent) && node == parent->rb_left)
+		node = parent;
+	return parent;
 }
@@ -0,0 +1,459 @@
+/*
+ * Copyright 2016 Red Hat Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDER(S) OR AUTHOR(S) BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Authors: Ben Skeggs <bskeggs@redhat.com>
+ */
+#include "priv.h"
+
+/* kmem_cache implementation, objects are carved from large chunks and
+ * cached in per-thread magazines (a loaded and a previous one, as per
+ * Bonwick's design), the cache-wide depot is only locked when both of
+ * a thread's magazines are empty (alloc) or full (free)
+ *
+ * memory is never handed back to the system until the cache is destroyed
+ *
+ * setting NVOS_SLAB_STATS in the environment enables per-cache counters,
+ * which are dumped when a cache is destroyed or at exit
+ */
+#define NVOS_SLAB_MAX 64
+#define NVOS_SLAB_MAG 32
+#define NVOS_SLAB_CHUNK (64 * 1024)
+
+struct nvos_slab_mag {
+	struct nvos_slab_mag *next;
+	int nr;
+	void *obj[NVOS_SLAB_MAG];
+};
+
+struct nvos_slab_chunk {
+	struct nvos_slab_chunk *next;
+};
+
+struct nvos_slab_stats {
+	u64 allocs;
+	u64 frees;
+	u64 refills;
+	u64 flushes;
+};
+
+struct nvos_slab_cpu {
+	struct kmem_cache *cache;
+	struct nvos_slab_mag *loaded;
+	struct nvos_slab_mag *previous;
+	struct nvos_slab_stats stats;
+};
+
+struct nvos_slab_thread {
+	struct list_head head;
+	struct nvos_slab_cpu cpu[NVOS_SLAB_MAX];
+};
+
+struct kmem_cache {
+	char name[32];
+	size_t size;
+	size_t align;
+	void (*ctor)(void *);
+	int id;
+
+	pthread_mutex_t lock;
+	struct nvos_slab_mag *full;
+	struct nvos_slab_mag *empty;
+	void *freelist;
+	struct nvos_slab_chunk *chunks;
+	u8 *chunk_pos;
+	u8 *chunk_end;
+	int chunk_nr;
+	struct nvos_slab_stats stats;
+};
+
+static pthread_mutex_t nvos_slab_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t nvos_slab_once = PTHREAD_ONCE_INIT;
+static pthread_key_t nvos_slab_key;
+static struct kmem_cache *nvos_slab[NVOS_SLAB_MAX];
+static LIST_HEAD(nvos_slab_threads);
+static __thread struct nvos_slab_thread *nvos_slab_self;
+static bool nvos_slab_stats;
+
+/******************************************************************************
+ * depot, called with cache->lock held
+ *****************************************************************************/
+static void *
+nvos_slab_carve(struct kmem_cache *cache)
+{
+	void *obj;
+
+	if ((obj = cache->freelist)) {
+		cache->freelist = *(void **)obj;
+		return obj;
+	}
+
+	if (cache->chunk_pos + cache->size > cache->chunk_end) {
+		size_t size = max_t(size_t, NVOS_SLAB_CHUNK, cache->size * 8);
+		struct nvos_slab_chunk *chunk = malloc(size);
+		if (!chunk)
+			return NULL;
+		chunk->next = cache->chunks;
+		cache->chunks = chunk;
+		cache->chunk_nr++;
+		cache->chunk_pos = (u8 *)ALIGN((unsigned long)(chunk + 1),
+					       cache->align);
+		cache->chunk_end = (u8 *)chunk + size;
+	}
+
+	obj = cache->chunk_pos;
+	cache->chunk_pos += cache->size;
+	if (cache->ctor)
+		cache->ctor(obj);
+	return obj;
+}
+
+static void
+nvos_slab_depot_put(struct kmem_cache *cache, struct nvos_slab_mag *mag)
+{
+	if (!mag)
+		return;
+	if (mag->nr) {
+		mag->next = cache->full;
+		cache->full = mag;
+	} else {
+		mag->next = cache->empty;
+		cache->empty = mag;
+	}
+}
+
+static void
+nvos_slab_stats_add(struct nvos_slab_stats *dst, struct nvos_slab_stats *src)
+{
+	dst->allocs  += src->allocs;
+	dst->frees   += src->frees;
+	dst->refills += src->refills;
+	dst->flushes += src->flushes;
+	memset(src, 0x00, sizeof(*src));
+}
+
+static void
+nvos_slab_dump(struct kmem_cache *cache)
+{
+	struct nvos_slab_stats stats = cache->stats;
+	struct nvos_slab_thread *thread;
+
+	list_for_each_entry(thread, &nvos_slab_threads, head) {
+		struct nvos_slab_cpu *cpu = &thread->cpu[cache->id];
+		if (cpu->cache == cache) {
+			stats.allocs  += cpu->stats.allocs;
+			stats.frees   += cpu->stats.frees;
+			stats.refills += cpu->stats.refills;
+			stats.flushes += cpu->stats.flushes;
+		}
+	}
+
+	fprintf(stderr, "slab: %-24s size %4zu chunks %4d allocs %llu "
+			"frees %llu refills %llu flushes %llu\n",
+		cache->name, cache->size, cache->chunk_nr, stats.allocs,
+		stats.frees, stats.refills, stats.flushes);
+}
+
+/******************************************************************************
+ * per-thread magazines
+ *****************************************************************************/
+static void
+nvos_slab_thread_fini(void *data)
+{
+	struct nvos_slab_thread *thread = data;
+	int i;
+
+	pthread_mutex_lock(&nvos_slab_mutex);
+	for (i = 0; i < NVOS_SLAB_MAX; i++) {
+		struct nvos_slab_cpu *cpu = &thread->cpu[i];
+		struct kmem_cache *cache = cpu->cache;
+		if (cache) {
+			pthread_mutex_lock(&cache->lock);
+			nvos_slab_depot_put(cache, cpu->loaded);
+			nvos_slab_depot_put(cache, cpu->previous);
+			nvos_slab_stats_add(&cache->stats, &cpu->stats);
+			pthread_mutex_unlock(&cache->lock);
+		}
+	}
+	list_del(&thread->head);
+	pthread_mutex_unlock(&nvos_slab_mutex);
+	free(thread);
+}
+
+static void
+nvos_slab_exit(void)
+{
+	int i;
+
+	pthread_mutex_lock(&nvos_slab_mutex);
+	for (i = 0; i < NVOS_SLAB_MAX; i++) {
+		if (nvos_slab[i])
+			nvos_slab_dump(nvos_slab[i]);
+	}
+	pthread_mutex_unlock(&nvos_slab_mutex);
+}
+
+static void
+nvos_slab_init(void)
+{
+	pthread_key_create(&nvos_slab_key, nvos_slab_thread_fini);
+	if (getenv("NVOS_SLAB_STATS")) {
+		nvos_slab_stats = true;
+		atexit(nvos_slab_exit);
+	}
+}
+
+static struct nvos_slab_cpu *
+nvos_slab_cpu(struct kmem_cache *cache)
+{
+	struct nvos_slab_thread *thread = nvos_slab_self;
+	struct nvos_slab_cpu *cpu;
+
+	if (unlikely(cache->id < 0))
+		return NULL;
+
+	if (unlikely(!thread)) {
+		if (!(thread = calloc(1, sizeof(*thread))))
+			return NULL;
+		pthread_mutex_lock(&nvos_slab_mutex);
+		list_add_tail(&thread->head, &nvos_slab_threads);
+		pthread_mutex_unlock(&nvos_slab_mutex);
+		pthread_setspecific(nvos_slab_key, thread);
+		nvos_slab_self = thread;
+	}
+
+	cpu = &thread->cpu[cache->id];
+	if (unlikely(cpu->cache != cache)) {
+		struct nvos_slab_mag *loaded = calloc(1, sizeof(*loaded));
+		struct nvos_slab_mag *previous = calloc(1, sizeof(*previous));
+		if (!loaded || !previous) {
+			free(previous);
+			free(loaded);
+			return NULL;
+		}
+		cpu->loaded = loaded;
+		cpu->previous = previous;
+		cpu->cache = cache;
+	}
+
+	return cpu;
+}
+
+static void *
+nvos_slab_refill(struct kmem_cache *cache, struct nvos_slab_cpu *cpu)
+{
+	struct nvos_slab_mag *mag;
+	void *obj;
+
+	pthread_mutex_lock(&cache->lock);
+	if ((mag = cache->full)) {
+		cache->full = mag->next;
+		nvos_slab_depot_put(cache, cpu->previous);
+		cpu->previous = cpu->loaded;
+		cpu->loaded = mag;
+	} else {
+		mag = cpu->loaded;
+		while (mag->nr < NVOS_SLAB_MAG) {
+			if (!(obj = nvos_slab_carve(cache)))
+				break;
+			mag->obj[mag->nr++] = obj;
+		}
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	cpu->stats.refills++;
+	if (!mag->nr)
+		return NULL;
+	return mag->obj[--mag->nr];
+}
+
+static void
+nvos_slab_flush(struct kmem_cache *cache, struct nvos_slab_cpu *cpu, void *obj)
+{
+	struct nvos_slab_mag *mag;
+
+	pthread_mutex_lock(&cache->lock);
+	if ((mag = cache->empty))
+		cache->empty = mag->next;
+	else
+		mag = calloc(1, sizeof(*mag));
+
+	if (mag) {
+		nvos_slab_depot_put(cache, cpu->previous);
+		cpu->previous = cpu->loaded;
+		cpu->loaded = mag;
+		mag->obj[mag->nr++] = obj;
+	} else {
+		*(void **)obj = cache->freelist;
+		cache->freelist = obj;
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	cpu->stats.flushes++;
+}
+
+/******************************************************************************
+ * kmem_cache interface
+ *****************************************************************************/
+void *
+kmem_cache_alloc(struct kmem_cache *cache, gfp_t gfp)
+{
+	struct nvos_slab_cpu *cpu = nvos_slab_cpu(cache);
+	struct nvos_slab_mag *mag;
+	void *obj;
+
+	if (likely(cpu)) {
+		if (nvos_slab_stats)
+			cpu->stats.allocs++;
+		if (likely((mag = cpu->loaded)->nr)) {
+			obj = mag->obj[--mag->nr];
+		} else
+		if ((mag = cpu->previous)->nr) {
+			cpu->previous = cpu->loaded;
+			cpu->loaded = mag;
+			obj = mag->obj[--mag->nr];
+		} else {
+			obj = nvos_slab_refill(cache, cpu);
+		}
+	} else {
+		pthread_mutex_lock(&cache->lock);
+		obj = nvos_slab_carve(cache);
+		pthread_mutex_unlock(&cache->lock);
+	}
+
+	if (obj && (gfp & __GFP_ZERO))
+		memset(obj, 0x00, cache->size);
+	return obj;
+}
+
+void
+kmem_cache_free(struct kmem_cache *cache, void *obj)
+{
+	struct nvos_slab_cpu *cpu;
+	struct nvos_slab_mag *mag;
+
+	if (unlikely(!obj))
+		return;
+
+	if (likely((cpu = nvos_slab_cpu(cache)))) {
+		if (nvos_slab_stats)
+			cpu->stats.frees++;
+		if (likely((mag = cpu->loaded)->nr < NVOS_SLAB_MAG)) {
+			mag->obj[mag->nr++] = obj;
+		} else
+		if ((mag = cpu->previous)->nr == 0) {
+			cpu->previous = cpu->loaded;
+			cpu->loaded = mag;
+			mag->obj[mag->nr++] = obj;
+		} else {
+			nvos_slab_flush(cache, cpu, obj);
+		}
+	} else {
+		pthread_mutex_lock(&cache->lock);
+		*(void **)obj = cache->freelist;
+		cache->freelist = obj;
+		pthread_mutex_unlock(&cache->lock);
+	}
+}
+
+void
+kmem_cache_destroy(struct kmem_cache *cache)
+{
+	struct nvos_slab_thread *thread;
+	struct nvos_slab_chunk *chunk;
+	struct nvos_slab_mag *mag;
+
+	if (!cache)
+		return;
+
+	pthread_mutex_lock(&nvos_slab_mutex);
+	if (cache->id >= 0) {
+		list_for_each_entry(thread, &nvos_slab_threads, head) {
+			struct nvos_slab_cpu *cpu = &thread->cpu[cache->id];
+			if (cpu->cache == cache) {
+				nvos_slab_stats_add(&cache->stats, &cpu->stats);
+				free(cpu->previous);
+				free(cpu->loaded);
+				cpu->previous = NULL;
+				cpu->loaded = NULL;
+				cpu->cache = NULL;
+			}
+		}
+		nvos_slab[cache->id] = NULL;
+	}
+
+	if (nvos_slab_stats)
+		nvos_slab_dump(cache);
+	pthread_mutex_unlock(&nvos_slab_mutex);
+
+	while ((mag = cache->full)) {
+		cache->full = mag->next;
+		free(mag);
+	}
+
+	while ((mag = cache->empty)) {
+		cache->empty = mag->next;
+		free(mag);
+	}
+
+	while ((chunk = cache->chunks)) {
+		cache->chunks = chunk->next;
+		free(chunk);
+	}
+
+	pthread_mutex_destroy(&cache->lock);
+	free(cache);
+}
+
+struct kmem_cache *
+kmem_cache_create(const char *name, size_t size, size_t align,
+		  unsigned long flags, void (*ctor)(void *))
+{
+	struct kmem_cache *cache;
+	int i;
+
+	pthread_once(&nvos_slab_once, nvos_slab_init);
+
+	if (!(cache = calloc(1, sizeof(*cache))))
+		return NULL;
+
+	if (flags & SLAB_HWCACHE_ALIGN)
+		align = max_t(size_t, align, 64);
+	align = max_t(size_t, align, sizeof(void *));
+
+	snprintf(cache->name, sizeof(cache->name), "%s", name);
+	cache->size = ALIGN(max_t(size_t, size, sizeof(void *)), align);
+	cache->align = align;
+	cache->ctor = ctor;
+	pthread_mutex_init(&cache->lock, NULL);
+
+	/* caches beyond the per-thread limit work, but always take the lock */
+	pthread_mutex_lock(&nvos_slab_mutex);
+	for (i = 0; i < NVOS_SLAB_MAX && nvos_slab[i]; i++) {
+	}
+	if (i < NVOS_SLAB_MAX) {
+		nvos_slab[i] = cache;
+		cache->id = i;
+	} else {
+		cache->id = -1;
+	}
+	pthread_mutex_unlock(&nvos_slab_mutex);
+	return cache;
+}
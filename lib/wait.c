@@ -0,0 +1,65 @@
+/*
+ * Copyright 2016 Red Hat Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDER(S) OR AUTHOR(S) BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Authors: Ben Skeggs <bskeggs@redhat.com>
+ */
+#include "priv.h"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+/* waitqueues, waiters sleep on a futex over the queue's sequence number,
+ * which every wake_up() bumps
+ *
+ * a waiter registers itself (and samples the sequence number) before its
+ * final check of the condition, so a wake_up() that follows the condition
+ * becoming true either sees the waiter or changes the sequence number out
+ * from under it
+ */
+u32
+nvos_wait_prepare(wait_queue_head_t *wq)
+{
+	__atomic_add_fetch(&wq->waiters, 1, __ATOMIC_SEQ_CST);
+	return __atomic_load_n(&wq->seq, __ATOMIC_SEQ_CST);
+}
+
+void
+nvos_wait(wait_queue_head_t *wq, u32 seq, s64 timeout)
+{
+	struct timespec ts = {
+		.tv_sec = timeout / 1000000000,
+		.tv_nsec = timeout % 1000000000,
+	};
+
+	if (timeout)
+		syscall(SYS_futex, &wq->seq, FUTEX_WAIT_PRIVATE, seq,
+			timeout > 0 ? &ts : NULL, NULL, 0);
+	__atomic_sub_fetch(&wq->waiters, 1, __ATOMIC_SEQ_CST);
+}
+
+void
+nvos_wake_up(wait_queue_head_t *wq)
+{
+	__atomic_add_fetch(&wq->seq, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&wq->waiters, __ATOMIC_SEQ_CST))
+		syscall(SYS_futex, &wq->seq, FUTEX_WAKE_PRIVATE, INT_MAX,
+			NULL, NULL, 0);
+}
@@ -23,85 +23,464 @@
  */
 #include "priv.h"
 
+/* shared workqueue, backed by a pool of workers (one per cpu), each with
+ * their own queue
+ *
+ * work is queued on an idle worker where possible, and workers steal from
+ * each other's queues before going to sleep
+ *
+ * as in the kernel, a work item never executes concurrently with itself,
+ * a worker that picks up an item that's already running elsewhere hands it
+ * to the worker that's running it
+ *
+ * a work item that flushes or cancels another can block its worker, once
+ * every worker is blocked that way, another worker is started to run what
+ * they're waiting on
+ */
+#define NVOS_WORKERS_MAX 32
+
 struct nvos_work {
+	pthread_t thread;
 	pthread_mutex_t mutex;
 	pthread_cond_t cond;
-	pthread_t thread;
-	bool done;
+	struct list_head queue;
+	bool idle;
 
-	void (*func)(void *);
-	void *priv;
+	/* protected by nvos_pool.mutex */
+	struct work_struct *running;
+	struct list_head busy;
 };
 
-static void *
-nvos_work(void *data)
+static struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t done;
+	struct nvos_work worker[NVOS_WORKERS_MAX];
+	int nr;
+	unsigned int next;
+	int threads; /* workers that started */
+	int blocked; /* workers waiting in flush/cancel */
+	int waiting; /* cancellers waiting for work to land on a queue */
+} nvos_pool = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.done = PTHREAD_COND_INITIALIZER,
+};
+
+static pthread_once_t nvos_pool_once = PTHREAD_ONCE_INIT;
+static __thread struct nvos_work *nvos_work_self;
+
+static struct work_struct *
+nvos_work_pop(struct nvos_work *worker)
 {
-	struct nvos_work *work = data;
+	struct work_struct *work = NULL;
+
+	pthread_mutex_lock(&worker->mutex);
+	if (!list_empty(&worker->queue)) {
+		work = list_first_entry(&worker->queue, typeof(*work), entry);
+		list_del(&work->entry);
+		__atomic_store_n(&work->nvos, NULL, __ATOMIC_SEQ_CST);
+	}
+	pthread_mutex_unlock(&worker->mutex);
+	return work;
+}
+
+static struct work_struct *
+nvos_work_next(struct nvos_work *worker)
+{
+	struct work_struct *work;
+	int id = worker - nvos_pool.worker, i;
+
+	for (i = 0; i < nvos_pool.nr; i++) {
+		worker = &nvos_pool.worker[(id + i) % nvos_pool.nr];
+		if ((work = nvos_work_pop(worker)))
+			return work;
+	}
+
+	return NULL;
+}
+
+static bool
+nvos_work_wake(struct nvos_work *worker)
+{
+	bool idle = false;
+
+	if (__atomic_load_n(&worker->idle, __ATOMIC_SEQ_CST)) {
+		pthread_mutex_lock(&worker->mutex);
+		if ((idle = worker->idle)) {
+			worker->idle = false;
+			pthread_cond_signal(&worker->cond);
+		}
+		pthread_mutex_unlock(&worker->mutex);
+	}
+
+	return idle;
+}
+
+/* called with nvos_pool.mutex held */
+static bool
+nvos_work_running(struct work_struct *work)
+{
+	int i;
+	for (i = 0; i < nvos_pool.nr; i++) {
+		if (nvos_pool.worker[i].running == work)
+			return true;
+	}
+	return false;
+}
+
+static void
+nvos_work_exec(struct nvos_work *worker, struct work_struct *work)
+{
+	int i;
+
+	pthread_mutex_lock(&nvos_pool.mutex);
+	for (i = 0; i < nvos_pool.nr; i++) {
+		struct nvos_work *owner = &nvos_pool.worker[i];
+		if (owner->running == work) {
+			list_add_tail(&work->entry, &owner->busy);
+			pthread_cond_broadcast(&nvos_pool.done);
+			pthread_mutex_unlock(&nvos_pool.mutex);
+			return;
+		}
+	}
 
 	do {
-		pthread_mutex_lock(&work->mutex);
-		while (!work->priv && !work->done)
-			pthread_cond_wait(&work->cond, &work->mutex);
-		if (work->priv) {
-			work->func(work->priv);
-			work->priv = NULL;
+		/* work may be freed, or queued again, once it starts */
+		worker->running = work;
+		__atomic_store_n(&work->pending, 0, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&nvos_pool.mutex);
+
+		work->func(work);
+
+		pthread_mutex_lock(&nvos_pool.mutex);
+		worker->running = NULL;
+		pthread_cond_broadcast(&nvos_pool.done);
+
+		work = NULL;
+		if (!list_empty(&worker->busy)) {
+			work = list_first_entry(&worker->busy, typeof(*work),
+						entry);
+			list_del(&work->entry);
 		}
-		pthread_mutex_unlock(&work->mutex);
-	} while (!work->done);
+	} while (work);
+	pthread_mutex_unlock(&nvos_pool.mutex);
+}
+
+static void *
+nvos_worker(void *data)
+{
+	struct nvos_work *worker = data;
+	struct work_struct *work;
+
+	nvos_work_self = worker;
+
+	for (;;) {
+		if (!(work = nvos_work_next(worker))) {
+			pthread_mutex_lock(&worker->mutex);
+			__atomic_store_n(&worker->idle, true, __ATOMIC_SEQ_CST);
+			pthread_mutex_unlock(&worker->mutex);
+
+			/* catch anything queued before we were marked idle */
+			if (!(work = nvos_work_next(worker))) {
+				pthread_mutex_lock(&worker->mutex);
+				while (worker->idle && list_empty(&worker->queue))
+					pthread_cond_wait(&worker->cond,
+							  &worker->mutex);
+				worker->idle = false;
+				pthread_mutex_unlock(&worker->mutex);
+				continue;
+			}
+
+			__atomic_store_n(&worker->idle, false, __ATOMIC_SEQ_CST);
+		}
+
+		nvos_work_exec(worker, work);
+	}
 
 	return NULL;
 }
 
-void
-nvos_work_fini(struct nvos_work **pwork)
+static void
+nvos_worker_init(struct nvos_work *worker)
+{
+	pthread_mutex_init(&worker->mutex, NULL);
+	pthread_cond_init(&worker->cond, NULL);
+	INIT_LIST_HEAD(&worker->queue);
+	INIT_LIST_HEAD(&worker->busy);
+}
+
+static bool
+nvos_worker_start(struct nvos_work *worker)
+{
+	if (pthread_create(&worker->thread, NULL, nvos_worker, worker))
+		return false;
+	pthread_detach(worker->thread);
+	nvos_pool.threads++;
+	return true;
+}
+
+static void
+nvos_pool_init(void)
+{
+	long nr = sysconf(_SC_NPROCESSORS_ONLN);
+	int i;
+
+	nr = clamp(nr, 1L, (long)NVOS_WORKERS_MAX);
+	for (i = 0; i < nr; i++)
+		nvos_worker_init(&nvos_pool.worker[i]);
+
+	/* a worker that failed to start still has its queue stolen from */
+	nvos_pool.nr = nr;
+	pthread_mutex_lock(&nvos_pool.mutex);
+	for (i = 0; i < nr; i++) {
+		if (!nvos_worker_start(&nvos_pool.worker[i]))
+			break;
+	}
+	pthread_mutex_unlock(&nvos_pool.mutex);
+
+	if (i == 0)
+		nvos_pool.nr = 0;
+}
+
+/* called with nvos_pool.mutex held, waits for nvos_pool.done, starting
+ * another worker first if the caller is the last one that was free to run
+ * whatever it's waiting for
+ */
+static void
+nvos_work_wait(void)
+{
+	struct nvos_work *worker;
+
+	if (!nvos_work_self) {
+		pthread_cond_wait(&nvos_pool.done, &nvos_pool.mutex);
+		return;
+	}
+
+	if (++nvos_pool.blocked >= nvos_pool.threads &&
+	    nvos_pool.nr < NVOS_WORKERS_MAX) {
+		worker = &nvos_pool.worker[nvos_pool.nr];
+		nvos_worker_init(worker);
+		__atomic_store_n(&nvos_pool.nr, nvos_pool.nr + 1,
+				 __ATOMIC_SEQ_CST);
+		WARN_ON(!nvos_worker_start(worker));
+	}
+
+	pthread_cond_wait(&nvos_pool.done, &nvos_pool.mutex);
+	nvos_pool.blocked--;
+}
+
+bool
+nvos_work_cancel(struct work_struct *work)
 {
-	struct nvos_work *work = *pwork;
-	if (work) {
-		pthread_mutex_lock(&work->mutex);
-		work->done = true;
-		pthread_cond_signal(&work->cond);
-		pthread_mutex_unlock(&work->mutex);
+	struct nvos_work *worker;
+	struct work_struct *temp;
+	bool ret = false;
+	int i;
+
+	pthread_mutex_lock(&nvos_pool.mutex);
+	while (!ret && __atomic_load_n(&work->pending, __ATOMIC_SEQ_CST)) {
+		if ((worker = __atomic_load_n(&work->nvos, __ATOMIC_SEQ_CST))) {
+			pthread_mutex_lock(&worker->mutex);
+			if (work->nvos == worker) {
+				list_del(&work->entry);
+				work->nvos = NULL;
+				ret = true;
+			}
+			pthread_mutex_unlock(&worker->mutex);
+			continue;
+		}
+
+		for (i = 0; !ret && i < nvos_pool.nr; i++) {
+			worker = &nvos_pool.worker[i];
+			list_for_each_entry(temp, &worker->busy, entry) {
+				if (temp == work) {
+					list_del(&work->entry);
+					ret = true;
+					break;
+				}
+			}
+		}
 
-		pthread_join(work->thread, NULL);
-		pthread_cond_destroy(&work->cond);
-		pthread_mutex_destroy(&work->mutex);
-		free(*pwork);
-		*pwork = NULL;
+		if (!ret) {
+			/* between queues, wait for it to land, which will
+			 * be signalled by whoever puts it somewhere
+			 */
+			__atomic_add_fetch(&nvos_pool.waiting, 1,
+					   __ATOMIC_SEQ_CST);
+			if (__atomic_load_n(&work->pending, __ATOMIC_SEQ_CST) &&
+			    !__atomic_load_n(&work->nvos, __ATOMIC_SEQ_CST))
+				nvos_work_wait();
+			__atomic_sub_fetch(&nvos_pool.waiting, 1,
+					   __ATOMIC_SEQ_CST);
+		}
 	}
+
+	if (ret) {
+		__atomic_store_n(&work->pending, 0, __ATOMIC_SEQ_CST);
+		pthread_cond_broadcast(&nvos_pool.done);
+	}
+
+	while (nvos_work_running(work))
+		nvos_work_wait();
+	pthread_mutex_unlock(&nvos_pool.mutex);
+	return ret;
 }
 
 bool
-nvos_work_init(void (*func)(void *), void *priv, struct nvos_work **pwork)
-{
-	struct nvos_work *work = *pwork;
-
-	if (unlikely(work == NULL)) {
-		if (!(work = calloc(1, sizeof(*work))))
-			return false;
-		work->func = func;
-		work->priv = NULL;
-		work->done = false;
-
-		if (pthread_mutex_init(&work->mutex, NULL))
-			goto fail_mutex;
-		if (pthread_cond_init(&work->cond, NULL))
-			goto fail_cond;
-		if (pthread_create(&work->thread, NULL, nvos_work, work))
-			goto fail_thread;
-		*pwork = work;
-	}
-
-	pthread_mutex_lock(&work->mutex);
-	work->priv = priv;
-	pthread_cond_signal(&work->cond);
-	pthread_mutex_unlock(&work->mutex);
+nvos_work_flush(struct work_struct *work)
+{
+	bool ret = false;
+
+	pthread_mutex_lock(&nvos_pool.mutex);
+	while (__atomic_load_n(&work->pending, __ATOMIC_SEQ_CST) ||
+	       nvos_work_running(work)) {
+		nvos_work_wait();
+		ret = true;
+	}
+	pthread_mutex_unlock(&nvos_pool.mutex);
+	return ret;
+}
+
+bool
+nvos_work_queue(struct work_struct *work)
+{
+	struct nvos_work *worker = NULL;
+	int i;
+
+	if (__atomic_exchange_n(&work->pending, 1, __ATOMIC_SEQ_CST))
+		return false;
+
+	pthread_once(&nvos_pool_once, nvos_pool_init);
+	BUG_ON(!nvos_pool.nr);
+
+	for (i = 0; i < nvos_pool.nr; i++) {
+		if (__atomic_load_n(&nvos_pool.worker[i].idle,
+				    __ATOMIC_SEQ_CST)) {
+			worker = &nvos_pool.worker[i];
+			break;
+		}
+	}
+
+	if (!worker) {
+		i = __atomic_fetch_add(&nvos_pool.next, 1, __ATOMIC_RELAXED);
+		worker = &nvos_pool.worker[i % nvos_pool.nr];
+	}
+
+	pthread_mutex_lock(&worker->mutex);
+	list_add_tail(&work->entry, &worker->queue);
+	__atomic_store_n(&work->nvos, worker, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&worker->mutex);
+
+	if (__atomic_load_n(&nvos_pool.waiting, __ATOMIC_SEQ_CST)) {
+		pthread_mutex_lock(&nvos_pool.mutex);
+		pthread_cond_broadcast(&nvos_pool.done);
+		pthread_mutex_unlock(&nvos_pool.mutex);
+	}
+
+	/* wake the worker we queued on, or else anyone that can steal it */
+	if (!nvos_work_wake(worker)) {
+		for (i = 0; i < nvos_pool.nr; i++) {
+			if (nvos_work_wake(&nvos_pool.worker[i]))
+				break;
+		}
+	}
+
 	return true;
+}
 
-fail_thread:
-	pthread_cond_destroy(&work->cond);
-fail_cond:
-	pthread_mutex_destroy(&work->mutex);
-fail_mutex:
-	free(work);
-	return false;
+/* dedicated unbound queues, each work item runs on a thread of its own so
+ * nothing on them ever waits for a worker, or ties up the shared pool
+ */
+struct workqueue_struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t idle;
+	int active;
+};
+
+struct nvos_wq_work {
+	struct workqueue_struct *wq;
+	struct work_struct *work;
+};
+
+static void
+nvos_wq_exec(struct workqueue_struct *wq, struct work_struct *work)
+{
+	__atomic_store_n(&work->pending, 0, __ATOMIC_SEQ_CST);
+	work->func(work);
+
+	pthread_mutex_lock(&wq->mutex);
+	if (!--wq->active)
+		pthread_cond_broadcast(&wq->idle);
+	pthread_mutex_unlock(&wq->mutex);
+}
+
+static void *
+nvos_wq_thread(void *data)
+{
+	struct nvos_wq_work args = *(struct nvos_wq_work *)data;
+	free(data);
+	nvos_wq_exec(args.wq, args.work);
+	return NULL;
+}
+
+bool
+queue_work(struct workqueue_struct *wq, struct work_struct *work)
+{
+	struct nvos_wq_work *args;
+	pthread_t thread;
+
+	if (__atomic_exchange_n(&work->pending, 1, __ATOMIC_SEQ_CST))
+		return false;
+
+	pthread_mutex_lock(&wq->mutex);
+	wq->active++;
+	pthread_mutex_unlock(&wq->mutex);
+
+	/* no thread to run it on, run it here instead */
+	if (!(args = malloc(sizeof(*args)))) {
+		nvos_wq_exec(wq, work);
+		return true;
+	}
+
+	args->wq = wq;
+	args->work = work;
+	if (pthread_create(&thread, NULL, nvos_wq_thread, args)) {
+		free(args);
+		nvos_wq_exec(wq, work);
+		return true;
+	}
+
+	pthread_detach(thread);
+	return true;
+}
+
+void
+flush_workqueue(struct workqueue_struct *wq)
+{
+	pthread_mutex_lock(&wq->mutex);
+	while (wq->active)
+		pthread_cond_wait(&wq->idle, &wq->mutex);
+	pthread_mutex_unlock(&wq->mutex);
+}
+
+void
+destroy_workqueue(struct workqueue_struct *wq)
+{
+	flush_workqueue(wq);
+	pthread_mutex_destroy(&wq->mutex);
+	pthread_cond_destroy(&wq->idle);
+	free(wq);
+}
+
+struct workqueue_struct *
+alloc_workqueue(const char *fmt, unsigned int flags, int max_active, ...)
+{
+	struct workqueue_struct *wq;
+
+	WARN_ON(!(flags & WQ_UNBOUND));
+	if (!(wq = calloc(1, sizeof(*wq))))
+		return NULL;
+
+	pthread_mutex_init(&wq->mutex, NULL);
+	pthread_cond_init(&wq->idle, NULL);
+	return wq;
 }